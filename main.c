@@ -4,43 +4,447 @@
 #include <stdbool.h>
 #include <ctype.h>
 #include <time.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sched.h>
 
 #define INT_MAX 2147483647
 
 // -------------------- Data Structures --------------------
+
+// Nodes are addressed by 32-bit handles into the owning BDD's node arena:
+// the node index shifted left by one, with the low bit used as a complement
+// flag that negates the function the handle refers to. Index 0 is never
+// allocated, so handle 0 means "no node". Index 1 is the single '1'
+// terminal and '0' is its complement. The high edge of a stored node is
+// never complemented, which keeps the representation canonical.
+typedef uint32_t BDDRef;
+
+#define BDD_NONE ((BDDRef)0)
+#define BDD_ONE ((BDDRef)2)
+#define BDD_ZERO ((BDDRef)3)
+#define BDD_IS_COMPLEMENT(r) ((r) & 1u)
+#define BDD_REGULAR(r) ((r) & ~1u)
+#define BDD_NOT(r) ((r) ^ 1u)
+#define BDD_IS_TERMINAL(r) (BDD_REGULAR(r) == BDD_ONE)
+
+// Packed 16-byte node record, four to a cache line. The variable is the
+// one at `level` in var_order; the terminal has no variable and reports
+// BDD_TERMINAL_LEVEL, which sorts below every real level.
 typedef struct BDDNode
 {
-    char var_name;
-    int var_index;
-    struct BDDNode *high;
-    struct BDDNode *low;
-    int id;
-    bool is_terminal;
-    char value;
-    bool visited;
+    uint32_t level;
+    BDDRef high;
+    BDDRef low;
+    uint32_t ref; // live parents plus protections (see Garbage Collection)
 } BDDNode;
 
+#define BDD_TERMINAL_LEVEL UINT32_MAX
+#define BDD_FREE_LEVEL (UINT32_MAX - 1) // level of a released arena slot
+
+_Static_assert(sizeof(BDDNode) == 16, "BDDNode must stay a packed 16-byte record");
+
+// Node arena: nodes live in fixed-size slabs that never move, so a handle
+// stays valid for the lifetime of the BDD and teardown frees whole slabs.
+#define ARENA_SLAB_BITS 14
+#define ARENA_SLAB_SIZE (1u << ARENA_SLAB_BITS)
+#define ARENA_SLAB_MASK (ARENA_SLAB_SIZE - 1)
+
+typedef struct
+{
+    BDDNode **slabs;
+    int slab_count;
+    int slab_capacity;
+    uint32_t next;      // first index never handed out
+    uint32_t free_list; // released slot to reuse first, 0 when empty
+    uint32_t in_use; // nodes currently allocated, the terminal excluded
+    uint32_t peak;   // high-water mark of in_use
+    bool shared;     // other threads read the slab directory (parallel apply)
+    BDDNode ***retired; // directories replaced while shared, freed afterwards
+    int retired_count;
+} NodeArena;
+
+// Unique table: one open-addressed hash set of node handles per level,
+// keyed on (high, low). Keeping levels apart keeps probe sequences short and
+// lets a level be scanned or rebuilt without touching the others. The
+// terminal never enters the table.
+typedef struct
+{
+    BDDRef *buckets;   // BDD_NONE marks an empty slot
+    uint32_t capacity; // always a power of two
+    uint32_t size;
+} UniqueSubtable;
+
+typedef struct
+{
+    UniqueSubtable *levels;
+    int level_count;
+    int size; // internal nodes across all levels
+} UniqueTable;
+
+// Computed table: direct-mapped, lossy memo of apply results keyed on
+// (op, f, g, h). A colliding insert simply overwrites the previous entry.
+// Binary operations leave h as BDD_NONE.
+typedef enum
+{
+    OP_ITE = 0,
+    OP_OR_CUBE,
+    OP_RESTRICT,
+    OP_EXISTS,
+    OP_COUNT,
+} BDDOp;
+
+typedef struct
+{
+    BDDRef f;
+    BDDRef g;
+    BDDRef h;
+    BDDRef result; // BDD_NONE marks an empty entry
+    uint32_t op;   // BDDOp in the low byte, the table generation above it
+} CacheEntry;
+
+typedef struct
+{
+    CacheEntry *entries;
+    int size; // always a power of two
+    uint32_t generation; // entries stored under an earlier one count as empty
+    unsigned long hits;
+    unsigned long misses;
+    unsigned char *locks; // stripe spinlocks while a parallel apply runs, else NULL
+#if BDD_STATS
+    unsigned long op_hits[OP_COUNT];
+    unsigned long op_misses[OP_COUNT];
+#endif
+} ComputedTable;
+
+// Build with -DBDD_STATS=1 to count table, cache and GC activity and time
+// the construction phases (see BDD_get_stats). Without it the counters are
+// compiled out and only the always-kept figures are reported.
+#ifndef BDD_STATS
+#define BDD_STATS 0
+#endif
+
+// Construction phases timed under BDD_STATS. Collection and reordering run
+// at checkpoints between the other phases and are not part of them.
+typedef enum
+{
+    BDD_PHASE_PARSE,        // parsing, normalizing and pruning the DNF
+    BDD_PHASE_TERMS,        // building the BDD of each term on its own
+    BDD_PHASE_OR,           // folding terms into results and merging results
+    BDD_PHASE_ORDER_SEARCH, // BDD_create_with_best_order_ex as a whole
+    BDD_PHASE_GC,
+    BDD_PHASE_REORDER,
+    BDD_PHASE_COUNT,
+} BDDPhase;
+
+// Snapshot returned by BDD_get_stats
+typedef struct
+{
+    bool enabled; // built with BDD_STATS; otherwise only the first group is filled
+    // Always kept
+    // Node figures leave out the terminal
+    uint32_t live_nodes; // reachable from a protected root; kept incrementally
+    uint32_t dead_nodes; // unreachable, awaiting collection
+    uint32_t peak_nodes; // most nodes held in the arena at once
+    unsigned long cache_hits;
+    unsigned long cache_misses;
+    // Counted under BDD_STATS
+    uint64_t unique_lookups; // find_or_create_node calls that reached the table
+    uint64_t unique_hits;    // lookups that found an existing node
+    uint64_t unique_probes;  // slots compared over all lookups
+    uint32_t unique_max_probe;
+    uint64_t nodes_allocated;
+    int max_depth; // deepest recursion of the apply operations
+    uint64_t op_cache_hits[OP_COUNT];
+    uint64_t op_cache_misses[OP_COUNT];
+    uint64_t gc_runs;
+    uint64_t gc_freed;
+    uint64_t sift_runs;
+    uint64_t level_swaps;
+    uint64_t phase_ns[BDD_PHASE_COUNT];
+} BDDStats;
+
+#ifndef BDD_CACHE_SIZE
+#define BDD_CACHE_SIZE (1 << 16)
+#endif
+
+#define UNIQUE_INITIAL_CAPACITY 64
+#define UNIQUE_MAX_LOAD_NUM 3 // grow once size exceeds 3/4 of capacity
+#define UNIQUE_MAX_LOAD_DEN 4
+
+// Interned variable names mapped to dense ids in order of first appearance
 typedef struct
 {
-    BDDNode **nodes;
+    char **names;      // indexed by variable id
+    int count;
     int capacity;
-    int size;
-} NodeDictionary;
+    int *slots;        // open-addressed hash of ids, -1 marks an empty slot
+    int slot_capacity; // always a power of two
+} VarTable;
+
+// Literal syntax of a DNF string. In letter syntax every letter is its own
+// variable, case-insensitively ("AB+!AC"). In name syntax a variable is a
+// case-sensitive identifier [A-Za-z_][A-Za-z0-9_]* and the literals of a
+// term are separated by '&', '*' or whitespace ("tenant_eu & !beta + admin").
+// DNF_SYNTAX_AUTO asks the constructors to tell the two apart from the
+// input (see dnf_detect_syntax).
+typedef enum
+{
+    DNF_SYNTAX_AUTO,
+    DNF_SYNTAX_LETTERS,
+    DNF_SYNTAX_NAMES,
+} DNFSyntax;
+
+// How BDD_create combines the per-term BDDs
+typedef enum
+{
+    BUILD_SEQUENTIAL, // fold every term into one growing accumulator
+    BUILD_BALANCED,   // OR term BDDs pairwise in a balanced tree
+    BUILD_CLUSTERED,  // fold terms sharing a top variable, then merge clusters pairwise
+} BDDBuildMode;
+
+// Why a construction was stopped (see BDDCreateOptions.node_limit and
+// BDD_set_memory_limit)
+typedef enum
+{
+    BDD_ABORT_NONE,
+    BDD_ABORT_NODES,  // more live nodes than the node limit
+    BDD_ABORT_MEMORY, // the memory cap was reached or an allocation failed
+} BDDAbort;
 
 typedef struct
 {
-    BDDNode *root;
-    char *var_order;
-    int *var_priority;
+    BDDRef root;
+    VarTable vars;
+    int *var_order;  // level -> variable id
+    int *var_level;  // variable id -> level
+    int *input_slot; // variable id -> position in BDD_use input strings
     int var_count;
     int node_count;
-    NodeDictionary unique;
+    int peak_nodes; // most nodes held in the arena at once during construction
+    bool auto_reorder;
+    int reorder_threshold;
+    int next_reorder; // table size at which the next automatic sift runs
+    int dead_nodes;   // nodes without references, freed by the next collection
+    double gc_dead_fraction;
+    int gc_floor;     // dead nodes the next automatic collection waits for
+    int node_limit;          // live nodes a construction may hold, 0 for no limit
+    int checkpoint_size;     // table size after the last construction checkpoint, plus
+                             // the nodes created since that the node limit ignores
+    bool abortable;          // a construction runs that the limits may stop
+    int aborted;             // BDDAbort reason once they did
+    BDDBuildMode build_mode; // how BDD_manager_add combines terms
+    DNFSyntax syntax;
+    NodeArena arena;
+    UniqueTable unique;
+    ComputedTable cache;
+    uint32_t *visit; // per arena index, the epoch of the traversal that last reached it
+    uint32_t visit_size;
+    uint32_t epoch;
+    BDDRef *work; // scratch stack of the reference cascades
+    int work_capacity;
+    struct ApplyPool *pool; // workers for parallel apply, NULL without them
+    bool parallel;          // a parallel apply runs; the tables take their locks
+    struct BDDFrozen *frozen; // kept by BDD_use_batch until the nodes change
+#if BDD_STATS
+    BDDStats stats;
+#endif
 } BDD;
 
+// One half of a forked ITE step, run by its owner or by a thief
+typedef struct
+{
+    BDDRef f;
+    BDDRef g;
+    BDDRef h;
+    int depth;
+    BDDRef result;
+    int done; // set, with release order, once result is stored
+} ApplyTask;
+
+// Work-stealing deque of one thread: the owner pushes and pops the newest
+// task at the bottom, thieves take the oldest from the top
+typedef struct
+{
+    pthread_mutex_t lock;
+    ApplyTask **tasks;
+    int top;
+    int bottom;
+    int capacity;
+} ApplyDeque;
+
+typedef struct ApplyPool
+{
+    BDD *bdd;
+    int threads;        // the calling thread plus threads - 1 workers
+    pthread_t *workers;
+    ApplyDeque *deques; // one per thread, the calling thread's first
+    pthread_mutex_t alloc_lock;   // arena and table-wide counters
+    pthread_mutex_t *level_locks; // one per unique subtable
+    int level_lock_count;
+    unsigned char *cache_locks;   // CACHE_LOCK_STRIPES spinlocks
+    pthread_mutex_t state_lock;
+    pthread_cond_t wake; // workers wait here between applies
+    pthread_cond_t idle; // the caller waits here for them to stop
+    int active;          // an apply is running
+    int running;         // workers inside it
+    bool shutdown;
+} ApplyPool;
+
+// A manager is a BDD used as a shared node store: one unique table,
+// variable order and computed table for any number of functions, each
+// held by a BDDFunction handle. Since the store is canonical, two handles
+// of one manager are equal exactly when their functions are.
+typedef BDD BDDManager;
+typedef BDDRef BDDFunction;
+
+// Counter updates that vanish without BDD_STATS. The amount is still
+// evaluated so that variables only fed to a counter stay used. Updates are
+// atomic, as the workers of a parallel apply count into the same BDD, and
+// the recursion depth is tracked per thread.
+#if BDD_STATS
+static _Thread_local int bdd_apply_depth;
+#define BDD_STATS_CLOCK() bdd_now_ns()
+#define BDD_STAT_ADD(bdd, field, n) __atomic_fetch_add(&(bdd)->stats.field, (n), __ATOMIC_RELAXED)
+#define BDD_STAT_MAX(bdd, field, n)                                                                   \
+    do {                                                                                              \
+        __typeof__((bdd)->stats.field) value_ = (n);                                                  \
+        __typeof__((bdd)->stats.field) seen_ = __atomic_load_n(&(bdd)->stats.field, __ATOMIC_RELAXED); \
+        while (value_ > seen_ && !__atomic_compare_exchange_n(&(bdd)->stats.field, &seen_, value_, true, \
+                                                              __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {  \
+        }                                                                                             \
+    } while (0)
+#define BDD_STAT_ENTER(bdd) BDD_STAT_MAX(bdd, max_depth, ++bdd_apply_depth)
+#define BDD_STAT_LEAVE(bdd) (bdd_apply_depth--)
+#else
+#define BDD_STATS_CLOCK() 0
+#define BDD_STAT_ADD(bdd, field, n) ((void)(n))
+#define BDD_STAT_MAX(bdd, field, n) ((void)(n))
+#define BDD_STAT_ENTER(bdd) ((void)0)
+#define BDD_STAT_LEAVE(bdd) ((void)0)
+#endif
+
+// Immutable flattened form of a finished BDD (see BDD_freeze). Nodes are
+// stored in level order starting with the root, so every edge points
+// forward; an edge holds the distance to the child shifted left by one,
+// with the low bit set when the edge is complemented. edge[0] is taken
+// for input '0' and edge[1] for '1'. The last node is the terminal.
+typedef struct
+{
+    uint32_t slot; // input position read by this node
+    uint32_t edge[2];
+} FrozenNode;
+
+typedef struct BDDFrozen
+{
+    const FrozenNode *nodes;
+    FrozenNode *owned; // same as nodes, or NULL when they live in a mapped file
+    int count;
+    bool negated; // the root edge is complemented
+    int input_width;
+} BDDFrozen;
+
+// Lazy enumeration of the satisfying cubes of a BDD, one root-to-'1' path
+// at a time (see BDD_cubes_begin)
+typedef struct
+{
+    BDD *bdd;
+    BDDRef *stack; // edges on the current path, with parity applied
+    int *state;    // per stack entry: 0 before the high branch, 1 before low, 2 done
+    int depth;
+    char *cube;    // '1', '0' or '-' per input position
+} BDDCubeIterator;
+
+// Header of the binary format written by BDD_save. The file continues with
+// var_order (var_count uint32 ids, top level first), the variable names by
+// id as NUL-terminated strings padded to a multiple of four bytes, the
+// FrozenNode array exactly as BDD_freeze lays it out and finally a 64-bit
+// FNV-1a checksum of everything before it. Fields are in native byte
+// order; a file from a machine of the other endianness fails the version
+// check. Every section is 4-byte aligned so the nodes can be evaluated
+// straight from a mapping (see BDD_frozen_map).
+typedef struct
+{
+    char magic[4]; // "BDDF"
+    uint32_t version;
+    uint32_t flags; // BDD_FILE_NEGATED, BDD_FILE_NAMES
+    uint32_t var_count;
+    uint32_t node_count;
+    uint32_t input_width;
+    uint32_t names_size; // bytes including padding
+    uint32_t reserved;
+} BDDFileHeader;
+
+#define BDD_FILE_VERSION 1
+#define BDD_FILE_NEGATED 1u // the root edge is complemented
+#define BDD_FILE_NAMES 2u   // variables use name syntax
+
+// Outcome of BDD_verify_dnf
+typedef struct
+{
+    bool equivalent;
+    uint64_t checked;     // assignments known to agree, plus the counterexample if any
+    char *counterexample; // lowest failing assignment in BDD_use form, or NULL; caller frees
+    char expected;        // DNF value at the counterexample
+    char actual;          // BDD value at the counterexample
+} BDDVerifyResult;
+
+// Zero-initialized options select the defaults
+typedef struct
+{
+    BDDBuildMode mode;
+    int cache_size;        // computed-table entries; 0 means BDD_CACHE_SIZE
+    bool auto_reorder;     // sift during construction as the table grows
+    int reorder_threshold; // table size that triggers the first sift; 0 for the default
+    double gc_dead_fraction; // collect once this share of the table is dead; 0 for the
+                             // default, 1 or more never collects automatically
+    int threads; // threads splitting large merges (see Parallel Apply); 0 or 1
+                 // keeps every operation on the calling thread
+    bool parallel_apply; // opts in to splitting merges over `threads`; without
+                         // it they stay on the calling thread, as the locking
+                         // has not yet been measured to pay off
+    int node_limit; // stop once more nodes than this are live, 0 for no limit;
+                    // the build then frees its nodes and fails with EFBIG
+    DNFSyntax syntax; // how the DNF and var_order are read; the default
+                      // DNF_SYNTAX_AUTO fails with EINVAL on ambiguous input
+} BDDCreateOptions;
+
+// Zero-initialized options select the defaults
+typedef struct
+{
+    int threads;             // worker threads; 0 uses one per online CPU
+    int candidates;          // orders to try; 0 means twice the variable count
+    unsigned int seed;       // base seed; every candidate derives its own
+    BDDCreateOptions create; // passed to every candidate build
+} BDDOrderSearchOptions;
+
+// Families of generated benchmark inputs (see workload_generate)
+typedef enum
+{
+    WORKLOAD_RANDOM,     // random terms over x0..x{vars-1}
+    WORKLOAD_ADDER,      // carry-out of a + b with `vars` bits per operand
+    WORKLOAD_COMPARATOR, // a > b with `vars` bits per operand
+} WorkloadFamily;
+
+typedef struct
+{
+    WorkloadFamily family;
+    int vars;       // variables for random terms, bits per operand otherwise
+    long terms;     // random family only
+    double density; // random family only: share of the window's variables in each term
+    int window;     // random family only: each term draws from this many consecutive
+                    // variables at a random offset; 0 draws from all of them
+    unsigned int seed;
+} WorkloadSpec;
+
 // Structure to represent a variable with negation
 typedef struct
 {
-    char name;
+    int var; // id in the owning BDD's VarTable
     bool negated;
 } Variable;
 
@@ -54,616 +458,5024 @@ typedef struct
 // Context for sorting
 typedef struct
 {
-    const int *var_priority;
+    const int *var_level;
 } SortContext;
 
+// Receives each completed term from a DNFParser. The literals are only
+// valid during the call.
+typedef void (*DNFTermHandler)(void *context, Variable *literals, int count);
+
+// Incremental DNF reader: input arrives in chunks of any size and every
+// completed term is passed to the handler with duplicate literals removed.
+// Contradictory and empty terms are dropped. All state lives here, so
+// parsers on different threads do not interfere.
+typedef struct
+{
+    DNFSyntax syntax;
+    VarTable *vars;
+    Variable *literals; // the term being read
+    int literal_count;
+    int literal_capacity;
+    char *name; // identifier that may continue in the next chunk
+    int name_length;
+    int name_capacity;
+    bool negated; // a '!' is waiting for its variable
+    uint64_t *seen; // per variable id, two bits: appears positive, appears negated
+    int seen_words;
+    DNFTermHandler on_term;
+    void *context;
+} DNFParser;
+
+#ifndef DNF_CHUNK_SIZE
+#define DNF_CHUNK_SIZE (64 * 1024)
+#endif
+
 // -------------------- Functions --------------------
 
-void init_var_priority(BDD *bdd)
+static uint32_t name_hash(const char *name, int len)
 {
-    bdd->var_priority = (int *)malloc(26 * sizeof(int));
-    for (int i = 0; i < 26; i++)
-        bdd->var_priority[i] = -1;
+    uint32_t h = 2166136261u; // FNV-1a
+    for (int i = 0; i < len; i++)
+        h = (h ^ (unsigned char)name[i]) * 16777619u;
+    return h;
+}
+
+void var_table_init(VarTable *vars)
+{
+    vars->count = 0;
+    vars->capacity = 16;
+    vars->names = malloc(vars->capacity * sizeof(char *));
+    vars->slot_capacity = 32;
+    vars->slots = malloc(vars->slot_capacity * sizeof(int));
+    for (int i = 0; i < vars->slot_capacity; i++)
+        vars->slots[i] = -1;
+}
+
+void var_table_free(VarTable *vars)
+{
+    for (int i = 0; i < vars->count; i++)
+        free(vars->names[i]);
+    free(vars->names);
+    free(vars->slots);
+}
+
+void var_table_copy(VarTable *dst, const VarTable *src)
+{
+    dst->count = src->count;
+    dst->capacity = src->capacity;
+    dst->names = malloc(dst->capacity * sizeof(char *));
+    for (int i = 0; i < src->count; i++)
+        dst->names[i] = strdup(src->names[i]);
+    dst->slot_capacity = src->slot_capacity;
+    dst->slots = malloc(dst->slot_capacity * sizeof(int));
+    memcpy(dst->slots, src->slots, dst->slot_capacity * sizeof(int));
+}
 
-    for (int i = 0; i < bdd->var_count; i++)
+// Returns the id of `name` (len bytes, not necessarily terminated) or -1
+int var_table_find(const VarTable *vars, const char *name, int len)
+{
+    int mask = vars->slot_capacity - 1;
+    for (int slot = name_hash(name, len) & mask; vars->slots[slot] != -1; slot = (slot + 1) & mask)
     {
-        bdd->var_priority[toupper(bdd->var_order[i]) - 'A'] = bdd->var_count - i - 1;
+        const char *candidate = vars->names[vars->slots[slot]];
+        if (strncmp(candidate, name, len) == 0 && candidate[len] == '\0')
+            return vars->slots[slot];
     }
+    return -1;
 }
 
-int compare_vars(void *context, const void *a, const void *b)
+// Returns the id of `name`, assigning the next free id on first sight
+int var_table_intern(VarTable *vars, const char *name, int len)
 {
-    SortContext *ctx = (SortContext *)context;
-    const Variable *va = (const Variable *)a;
-    const Variable *vb = (const Variable *)b;
+    int id = var_table_find(vars, name, len);
+    if (id >= 0)
+        return id;
 
-    int prio_a = ctx->var_priority[toupper(va->name) - 'A'];
-    int prio_b = ctx->var_priority[toupper(vb->name) - 'A'];
+    if (vars->count == vars->capacity)
+    {
+        vars->capacity *= 2;
+        vars->names = realloc(vars->names, vars->capacity * sizeof(char *));
+    }
+    id = vars->count++;
+    vars->names[id] = strndup(name, len);
 
-    // First sort by priority, then by negation (non-negated first)
-    if (prio_a != prio_b)
-        return prio_b - prio_a;
-    return va->negated - vb->negated;
+    // Keep the hash at most half full
+    if (vars->count * 2 > vars->slot_capacity)
+    {
+        free(vars->slots);
+        vars->slot_capacity *= 2;
+        vars->slots = malloc(vars->slot_capacity * sizeof(int));
+        for (int i = 0; i < vars->slot_capacity; i++)
+            vars->slots[i] = -1;
+        for (int i = 0; i < vars->count; i++)
+        {
+            int mask = vars->slot_capacity - 1;
+            int slot = name_hash(vars->names[i], strlen(vars->names[i])) & mask;
+            while (vars->slots[slot] != -1)
+                slot = (slot + 1) & mask;
+            vars->slots[slot] = i;
+        }
+        return id;
+    }
+
+    int mask = vars->slot_capacity - 1;
+    int slot = name_hash(name, len) & mask;
+    while (vars->slots[slot] != -1)
+        slot = (slot + 1) & mask;
+    vars->slots[slot] = id;
+    return id;
+}
+
+// Expressions that use an explicit conjunction operator, underscores or
+// digits are read with name syntax. Otherwise the letters are variables of
+// their own, unless two adjacent letters include a lowercase one: "admin"
+// may be five letters or one name, so that input gives DNF_SYNTAX_AUTO
+// and the caller has to choose with BDDCreateOptions.syntax.
+static DNFSyntax dnf_detect_syntax_n(const char *dnf, size_t size)
+{
+    bool ambiguous = false;
+    for (size_t i = 0; i < size; i++)
+    {
+        unsigned char c = dnf[i];
+        if (c == '&' || c == '*' || c == '_' || isdigit(c))
+            return DNF_SYNTAX_NAMES;
+        if (i > 0 && isalpha(c) && isalpha((unsigned char)dnf[i - 1]) &&
+            (islower(c) || islower((unsigned char)dnf[i - 1])))
+            ambiguous = true;
+    }
+    return ambiguous ? DNF_SYNTAX_AUTO : DNF_SYNTAX_LETTERS;
+}
+
+DNFSyntax dnf_detect_syntax(const char *dnf)
+{
+    return dnf_detect_syntax_n(dnf, strlen(dnf));
+}
+
+// Settles the syntax for a DNF (of which `size` bytes are at hand) and its
+// order string. An explicit request wins; in auto mode name syntax in
+// either string decides. Returns DNF_SYNTAX_AUTO if the input stays
+// ambiguous.
+static DNFSyntax dnf_choose_syntax(DNFSyntax requested, const char *dnf, size_t size, const char *var_order)
+{
+    if (requested != DNF_SYNTAX_AUTO)
+        return requested;
+    DNFSyntax input = dnf_detect_syntax_n(dnf, size);
+    DNFSyntax order = var_order ? dnf_detect_syntax(var_order) : DNF_SYNTAX_LETTERS;
+    if (input == DNF_SYNTAX_NAMES || order == DNF_SYNTAX_NAMES)
+        return DNF_SYNTAX_NAMES;
+    if (input == DNF_SYNTAX_AUTO || order == DNF_SYNTAX_AUTO)
+        return DNF_SYNTAX_AUTO;
+    return DNF_SYNTAX_LETTERS;
+}
+
+static bool is_var_start(DNFSyntax syntax, char c)
+{
+    if (syntax == DNF_SYNTAX_LETTERS)
+        return isalpha((unsigned char)c);
+    return isalpha((unsigned char)c) || c == '_';
+}
+
+// Interns the variable named at *p (which must satisfy is_var_start) and
+// advances *p past it
+static int intern_var_at(VarTable *vars, DNFSyntax syntax, const char **p)
+{
+    if (syntax == DNF_SYNTAX_LETTERS)
+    {
+        char name = toupper((unsigned char)**p);
+        (*p)++;
+        return var_table_intern(vars, &name, 1);
+    }
+
+    const char *start = *p;
+    while (isalnum((unsigned char)**p) || **p == '_')
+        (*p)++;
+    return var_table_intern(vars, start, *p - start);
+}
+
+// Looks up the variable named at *p (which must satisfy is_var_start)
+// without interning it and advances *p past it. Returns -1 if unknown.
+static int find_var_at(const VarTable *vars, DNFSyntax syntax, const char **p)
+{
+    if (syntax == DNF_SYNTAX_LETTERS)
+    {
+        char name = toupper((unsigned char)**p);
+        (*p)++;
+        return var_table_find(vars, &name, 1);
+    }
+
+    const char *start = *p;
+    while (isalnum((unsigned char)**p) || **p == '_')
+        (*p)++;
+    return var_table_find(vars, start, *p - start);
 }
 
-DNFTerm *normalize_dnf(const char *dnf, const char *var_order, int *term_count)
+int compare_vars(const SortContext *ctx, const Variable *va, const Variable *vb)
 {
-    BDD temp_bdd;
-    temp_bdd.var_order = strdup(var_order);
-    temp_bdd.var_count = strlen(var_order);
-    init_var_priority(&temp_bdd);
+    int level_a = ctx->var_level[va->var];
+    int level_b = ctx->var_level[vb->var];
 
-    // Initial term count estimate
-    char *copy = strdup(dnf);
-    int estimated_terms = 1;
-    for (char *p = copy; *p; p++)
-        if (*p == '+')
-            estimated_terms++;
+    // First sort by level, then by negation (non-negated first)
+    if (level_a != level_b)
+        return level_a - level_b;
+    return va->negated - vb->negated;
+}
 
-    DNFTerm *terms = malloc(estimated_terms * sizeof(DNFTerm));
-    SortContext ctx = {.var_priority = temp_bdd.var_priority};
+// Literals of a term above which sort_term_vars hands it to qsort
+#define TERM_SORT_CUTOFF 16
 
-    int valid_terms = 0;
-    char *term_str = strtok(copy, "+");
+static int compare_literal_keys(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
 
-    while (term_str != NULL)
+// Short terms take a stable insertion sort, which beats qsort on a few
+// literals. Named variables allow terms of any length, so longer ones are
+// packed into keys (level, then negation, then the id to unpack) and
+// sorted by qsort with a plain comparator; that also avoids the BSD/glibc
+// disagreement over the qsort_r argument order.
+void sort_term_vars(Variable *vars, int count, const SortContext *ctx)
+{
+    if (count > TERM_SORT_CUTOFF)
     {
-        // Parse variables with negations
-        Variable vars[26];
-        int pos = 0;
-        bool in_negation = false;
+        uint64_t *keys = malloc(count * sizeof(uint64_t));
+        for (int i = 0; i < count; i++)
+            keys[i] = (uint64_t)ctx->var_level[vars[i].var] << 32 | (uint64_t)vars[i].negated << 31 |
+                      (uint32_t)vars[i].var;
+        qsort(keys, count, sizeof(uint64_t), compare_literal_keys);
+        for (int i = 0; i < count; i++)
+        {
+            vars[i].var = (int)(keys[i] & 0x7FFFFFFF);
+            vars[i].negated = keys[i] >> 31 & 1;
+        }
+        free(keys);
+        return;
+    }
 
-        for (char *p = term_str; *p; p++)
+    for (int i = 1; i < count; i++)
+    {
+        Variable key = vars[i];
+        int j = i - 1;
+        while (j >= 0 && compare_vars(ctx, &vars[j], &key) > 0)
         {
-            if (*p == ' ')
-                continue;
+            vars[j + 1] = vars[j];
+            j--;
+        }
+        vars[j + 1] = key;
+    }
+}
+
+void dnf_parser_init(DNFParser *parser, DNFSyntax syntax, VarTable *vars, DNFTermHandler on_term, void *context)
+{
+    parser->syntax = syntax;
+    parser->vars = vars;
+    parser->literal_count = 0;
+    parser->literal_capacity = 16;
+    parser->literals = malloc(parser->literal_capacity * sizeof(Variable));
+    parser->name_length = 0;
+    parser->name_capacity = 32;
+    parser->name = malloc(parser->name_capacity);
+    parser->negated = false;
+    parser->seen_words = 4;
+    parser->seen = calloc(parser->seen_words, sizeof(uint64_t));
+    parser->on_term = on_term;
+    parser->context = context;
+}
+
+void dnf_parser_free(DNFParser *parser)
+{
+    free(parser->literals);
+    free(parser->name);
+    free(parser->seen);
+}
+
+static void dnf_parser_add_literal(DNFParser *parser, int var)
+{
+    if (parser->literal_count == parser->literal_capacity)
+    {
+        parser->literal_capacity *= 2;
+        parser->literals = realloc(parser->literals, parser->literal_capacity * sizeof(Variable));
+    }
+    parser->literals[parser->literal_count].var = var;
+    parser->literals[parser->literal_count].negated = parser->negated;
+    parser->literal_count++;
+    parser->negated = false;
+}
+
+static void dnf_parser_end_name(DNFParser *parser)
+{
+    if (parser->name_length == 0)
+        return;
+    dnf_parser_add_literal(parser, var_table_intern(parser->vars, parser->name, parser->name_length));
+    parser->name_length = 0;
+}
+
+static void dnf_parser_end_term(DNFParser *parser)
+{
+    dnf_parser_end_name(parser);
+    Variable *vars = parser->literals;
+    int pos = parser->literal_count;
+    parser->literal_count = 0;
+    parser->negated = false;
+
+    // Check for contradiction and remove duplicates with one bit pair per
+    // variable: bit 2v marks a positive literal, bit 2v+1 a negated one
+    int needed = (int)(((uint64_t)parser->vars->count * 2 + 63) / 64);
+    if (needed > parser->seen_words)
+    {
+        parser->seen = realloc(parser->seen, needed * sizeof(uint64_t));
+        memset(parser->seen + parser->seen_words, 0, (needed - parser->seen_words) * sizeof(uint64_t));
+        parser->seen_words = needed;
+    }
+    uint64_t *seen = parser->seen;
+    bool contradiction = false;
+    int kept = 0;
+    for (int j = 0; j < pos; j++)
+    {
+        int bit = 2 * vars[j].var + vars[j].negated;
+        uint64_t same = 1ULL << (bit & 63), opposite = 1ULL << ((bit ^ 1) & 63);
+        if (seen[(bit ^ 1) >> 6] & opposite)
+            contradiction = true;
+        if (seen[bit >> 6] & same)
+            continue;
+        seen[bit >> 6] |= same;
+        vars[kept++] = vars[j];
+    }
+    for (int j = 0; j < kept; j++)
+        seen[vars[j].var >> 5] = 0;
+    pos = kept;
+
+    if (!contradiction && pos > 0)
+        parser->on_term(parser->context, vars, pos);
+}
+
+// Consumes the next `size` bytes of the expression. Chunk boundaries may
+// fall anywhere, including inside a variable name.
+void dnf_parser_feed(DNFParser *parser, const char *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        char c = data[i];
 
-            if (*p == '!')
+        // Continue a name started earlier, possibly in a previous chunk
+        if (parser->name_length > 0)
+        {
+            if (isalnum((unsigned char)c) || c == '_')
             {
-                in_negation = true;
+                if (parser->name_length == parser->name_capacity)
+                {
+                    parser->name_capacity *= 2;
+                    parser->name = realloc(parser->name, parser->name_capacity);
+                }
+                parser->name[parser->name_length++] = c;
                 continue;
             }
+            dnf_parser_end_name(parser);
+        }
 
-            if (isalpha(*p))
+        if (c == '+')
+        {
+            dnf_parser_end_term(parser);
+        }
+        else if (c == '!')
+        {
+            parser->negated = true;
+        }
+        else if (is_var_start(parser->syntax, c))
+        {
+            if (parser->syntax == DNF_SYNTAX_LETTERS)
+            {
+                char name = toupper((unsigned char)c);
+                dnf_parser_add_literal(parser, var_table_intern(parser->vars, &name, 1));
+            }
+            else
             {
-                vars[pos].name = toupper(*p);
-                vars[pos].negated = in_negation;
-                pos++;
-                in_negation = false;
+                parser->name[parser->name_length++] = c;
             }
         }
+        // Anything else separates literals: whitespace, newlines, '&', '*'
+    }
+}
+
+// Completes the last term once the input has ended
+void dnf_parser_finish(DNFParser *parser)
+{
+    dnf_parser_end_term(parser);
+}
+
+typedef struct
+{
+    DNFTerm *terms;
+    int count;
+    int capacity;
+} TermList;
+
+static void collect_term(void *context, Variable *literals, int count)
+{
+    TermList *list = context;
+    if (list->count == list->capacity)
+    {
+        list->capacity *= 2;
+        list->terms = realloc(list->terms, list->capacity * sizeof(DNFTerm));
+    }
+    DNFTerm *term = &list->terms[list->count++];
+    term->vars = malloc(count * sizeof(Variable));
+    memcpy(term->vars, literals, count * sizeof(Variable));
+    term->length = count;
+}
+
+// Parses a DNF into terms over variable ids interned in `vars`. Literals
+// are left in source order; sort them with sort_term_vars once the
+// variable order is known.
+DNFTerm *normalize_dnf(const char *dnf, DNFSyntax syntax, VarTable *var_table, int *term_count)
+{
+    TermList list = {.count = 0, .capacity = 16};
+    list.terms = malloc(list.capacity * sizeof(DNFTerm));
+
+    DNFParser parser;
+    dnf_parser_init(&parser, syntax, var_table, collect_term, &list);
+    dnf_parser_feed(&parser, dnf, strlen(dnf));
+    dnf_parser_finish(&parser);
+    dnf_parser_free(&parser);
+
+    *term_count = list.count;
+    return list.terms;
+}
+
+// Removes duplicate terms and terms subsumed by another term (every literal
+// of the other term also appears in it, so it adds nothing to the
+// disjunction). Terms are compared as bitmasks of positive and negated
+// variables. Candidates are visited shortest first, and each kept term is
+// indexed under its least frequent literal, so a term is only tested
+// against kept terms filed under one of its own literals. Survivors keep
+// their relative order. Returns the new term count.
+int dnf_prune_terms(DNFTerm *terms, int term_count, int var_count)
+{
+    if (term_count < 2)
+        return term_count;
+
+    int words = (var_count + 63) / 64;
+    if (words == 0)
+        words = 1;
+    uint64_t *masks = calloc((size_t)term_count * 2 * words, sizeof(uint64_t)); // pos words, then neg words
+    int *frequency = calloc(2 * var_count, sizeof(int));
+    int max_length = 0;
+    for (int t = 0; t < term_count; t++)
+    {
+        uint64_t *mask = masks + (size_t)t * 2 * words;
+        for (int k = 0; k < terms[t].length; k++)
+        {
+            const Variable *lit = &terms[t].vars[k];
+            mask[lit->negated * words + (lit->var >> 6)] |= 1ULL << (lit->var & 63);
+            frequency[2 * lit->var + lit->negated]++;
+        }
+        if (terms[t].length > max_length)
+            max_length = terms[t].length;
+    }
+
+    // Counting sort by length; ties keep input order
+    int *by_length = calloc(max_length + 2, sizeof(int));
+    for (int t = 0; t < term_count; t++)
+        by_length[terms[t].length + 1]++;
+    for (int l = 0; l <= max_length; l++)
+        by_length[l + 1] += by_length[l];
+    int *order = malloc(term_count * sizeof(int));
+    for (int t = 0; t < term_count; t++)
+        order[by_length[terms[t].length]++] = t;
 
-        // Check for contradiction and remove duplicates
-        bool contradiction = false;
-        for (int j = 0; j < pos; j++)
+    // Kept terms chained per key literal
+    int *bucket = malloc(2 * var_count * sizeof(int));
+    for (int l = 0; l < 2 * var_count; l++)
+        bucket[l] = -1;
+    int *next = malloc(term_count * sizeof(int));
+    bool *removed = calloc(term_count, sizeof(bool));
+
+    for (int i = 0; i < term_count; i++)
+    {
+        int t = order[i];
+        const uint64_t *mask = masks + (size_t)t * 2 * words;
+        for (int k = 0; k < terms[t].length && !removed[t]; k++)
         {
-            for (int k = j + 1; k < pos; k++)
+            const Variable *lit = &terms[t].vars[k];
+            for (int s = bucket[2 * lit->var + lit->negated]; s >= 0; s = next[s])
             {
-                if (vars[j].name == vars[k].name)
+                const uint64_t *other = masks + (size_t)s * 2 * words;
+                bool subset = true;
+                for (int w = 0; w < 2 * words && subset; w++)
+                    subset = (other[w] & ~mask[w]) == 0;
+                if (subset)
                 {
-                    if (vars[j].negated != vars[k].negated)
-                    {
-                        contradiction = true;
-                        break;
-                    }
-                    else
-                    {
-                        // Same polarity, remove duplicate
-                        for (int l = k; l < pos - 1; l++)
-                        {
-                            vars[l] = vars[l + 1];
-                        }
-                        pos--;
-                        k--;
-                    }
+                    removed[t] = true;
+                    break;
                 }
             }
-            if (contradiction)
-                break;
         }
+        if (removed[t] || terms[t].length == 0)
+            continue;
 
-        if (!contradiction)
+        int key = 0;
+        for (int k = 1; k < terms[t].length; k++)
         {
-            qsort_r(vars, pos, sizeof(Variable), &ctx, compare_vars);
-            terms[valid_terms].vars = malloc(pos * sizeof(Variable));
-            memcpy(terms[valid_terms].vars, vars, pos * sizeof(Variable));
-            terms[valid_terms].length = pos;
-            valid_terms++;
+            const Variable *lit = &terms[t].vars[k];
+            const Variable *best = &terms[t].vars[key];
+            if (frequency[2 * lit->var + lit->negated] < frequency[2 * best->var + best->negated])
+                key = k;
         }
-
-        term_str = strtok(NULL, "+");
+        int code = 2 * terms[t].vars[key].var + terms[t].vars[key].negated;
+        next[t] = bucket[code];
+        bucket[code] = t;
     }
 
-    free(copy);
-    free(temp_bdd.var_order);
-    free(temp_bdd.var_priority);
+    int kept = 0;
+    for (int t = 0; t < term_count; t++)
+    {
+        if (removed[t])
+            free(terms[t].vars);
+        else
+            terms[kept++] = terms[t];
+    }
 
-    *term_count = valid_terms;
-    return terms;
+    free(removed);
+    free(next);
+    free(bucket);
+    free(order);
+    free(by_length);
+    free(frequency);
+    free(masks);
+    return kept;
 }
 
-void print_term(const DNFTerm *term)
+void print_term(const DNFTerm *term, const VarTable *vars)
 {
     for (int i = 0; i < term->length; i++)
     {
         if (term->vars[i].negated)
             printf("!");
-        printf("%c", term->vars[i].name);
+        printf("%s", vars->names[term->vars[i].var]);
     }
 }
 
-// -------------------- BDD Creation --------------------
-BDDNode* create_terminal_node(BDD *bdd, char value) {
-    for (int i = 0; i < bdd->unique.size; i++) {
-        BDDNode *node = bdd->unique.nodes[i];
-        if (node->is_terminal && node->value == value) {
-            return node;
-        }
-    }
+// -------------------- Memory Accounting --------------------
+// Bytes all BDDs hold in node slabs and unique-table buckets, and the cap
+// on them (0 for none). Only growth during a construction is checked
+// against the cap; other allocations are counted but always succeed.
+static size_t bdd_memory_limit;
+static size_t bdd_memory_used;
 
-    BDDNode *node = malloc(sizeof(BDDNode));
-    node->is_terminal = true;
-    node->value = value;
-    node->high = node->low = NULL;
-    node->id = bdd->node_count++;  // Increment count here
-    
-    // Add to unique table
-    if (bdd->unique.size >= bdd->unique.capacity) {
-        bdd->unique.capacity *= 2;
-        bdd->unique.nodes = realloc(bdd->unique.nodes, 
-                                  bdd->unique.capacity * sizeof(BDDNode*));
-    }
-    bdd->unique.nodes[bdd->unique.size++] = node;
-    
-    return node;
+static void bdd_memory_charge(size_t bytes) {
+    __atomic_fetch_add(&bdd_memory_used, bytes, __ATOMIC_RELAXED);
 }
 
-void mark_reachable(BDDNode *node) {
-    if (!node || node->visited) return;
-    
-    node->visited = true;
-    
-    if (!node->is_terminal) {
-        mark_reachable(node->high);
-        mark_reachable(node->low);
-    }
+static void bdd_memory_release(size_t bytes) {
+    __atomic_fetch_sub(&bdd_memory_used, bytes, __ATOMIC_RELAXED);
 }
 
-void update_node_count(BDD *bdd) {
-    // Reset visited flags
-    for (int i = 0; i < bdd->unique.size; i++) {
-        bdd->unique.nodes[i]->visited = false;
-    }
-    
-    // Mark reachable nodes from root
-    mark_reachable(bdd->root);
-    
-    // Count marked nodes
-    int count = 0;
-    for (int i = 0; i < bdd->unique.size; i++) {
-        if (bdd->unique.nodes[i]->visited) {
-            count++;
-        }
+// Charges an allocation; if `capped` and it would pass the cap, charges
+// nothing and returns false
+static bool bdd_memory_reserve(size_t bytes, bool capped) {
+    size_t used = __atomic_add_fetch(&bdd_memory_used, bytes, __ATOMIC_RELAXED);
+    size_t limit = __atomic_load_n(&bdd_memory_limit, __ATOMIC_RELAXED);
+    if (capped && limit > 0 && used > limit) {
+        bdd_memory_release(bytes);
+        return false;
     }
-    
-    bdd->node_count = count;
+    return true;
 }
 
-BDDNode* find_or_create_node(BDD *bdd, char var_name, int var_index, BDDNode *high, BDDNode *low) {
-    // Eliminate redundant nodes (1st reduction)
-    if (high == low) {
-        return high;
-    }
+// Caps the memory of all BDDs together; 0 removes the cap. A construction
+// that would pass it stops and fails with ENOMEM (see BDDCreateOptions).
+// Returns the previous cap.
+size_t BDD_set_memory_limit(size_t bytes) {
+    return __atomic_exchange_n(&bdd_memory_limit, bytes, __ATOMIC_RELAXED);
+}
 
-    // Check for existing isomorphic nodes (2nd reduction)
-    for (int i = 0; i < bdd->unique.size; i++) {
-        BDDNode *node = bdd->unique.nodes[i];
-        if (!node->is_terminal &&
-            node->var_name == var_name &&
-            node->var_index == var_index &&
-            node->high == high &&
-            node->low == low) {
-            return node;
-        }
-    }
+size_t BDD_memory_in_use(void) {
+    return __atomic_load_n(&bdd_memory_used, __ATOMIC_RELAXED);
+}
 
-    // Create new node
-    BDDNode *node = malloc(sizeof(BDDNode));
-    node->var_name = var_name;
-    node->var_index = var_index;
-    node->high = high;
-    node->low = low;
-    node->is_terminal = false;
-    node->id = bdd->node_count++;
-    
-    // Add to unique table
-    if (bdd->unique.size >= bdd->unique.capacity) {
-        bdd->unique.capacity *= 2;
-        bdd->unique.nodes = realloc(bdd->unique.nodes, 
-                                  bdd->unique.capacity * sizeof(BDDNode*));
-    }
-    bdd->unique.nodes[bdd->unique.size++] = node;
-    
-    return node;
+// -------------------- Node Arena --------------------
+static inline BDDNode* bdd_node(const BDD *bdd, BDDRef ref) {
+    uint32_t index = ref >> 1;
+    // The directory may be replaced by another thread during a parallel apply
+    BDDNode **slabs = __atomic_load_n(&bdd->arena.slabs, __ATOMIC_ACQUIRE);
+    return &slabs[index >> ARENA_SLAB_BITS][index & ARENA_SLAB_MASK];
 }
 
-BDDNode* build_term_bdd(BDD *bdd, DNFTerm *term, int var_index) {
-    if (var_index >= bdd->var_count) {
-        // All variables processed - this term is satisfied
-        return create_terminal_node(bdd, '1');
-    }
+void arena_init(NodeArena *arena) {
+    arena->slab_capacity = 8;
+    arena->slab_count = 1;
+    arena->slabs = malloc(arena->slab_capacity * sizeof(BDDNode*));
+    arena->slabs[0] = malloc(ARENA_SLAB_SIZE * sizeof(BDDNode));
+    bdd_memory_charge(ARENA_SLAB_SIZE * sizeof(BDDNode));
 
-    char current_var = bdd->var_order[var_index];
-    bool exists = false;
-    bool negated = false;
+    // Index 0 is reserved for BDD_NONE and index 1 holds the terminal
+    BDDNode *one = &arena->slabs[0][1];
+    one->level = BDD_TERMINAL_LEVEL;
+    one->high = one->low = BDD_NONE;
+    one->ref = 0;
+    arena->next = 2;
+    arena->free_list = 0;
+    arena->in_use = arena->peak = 0;
+    arena->shared = false;
+    arena->retired = NULL;
+    arena->retired_count = 0;
+}
 
-    // Check if variable exists in term
-    for (int i = 0; i < term->length; i++) {
-        if (term->vars[i].name == current_var) {
-            exists = true;
-            negated = term->vars[i].negated;
-            break;
-        }
+// Returns the handle of a fresh, uninitialized node, or BDD_NONE if it
+// needs a new slab that cannot be allocated or, when `capped`, would pass
+// the memory cap
+BDDRef arena_alloc(NodeArena *arena, bool capped) {
+    if (arena->free_list) {
+        // Released slots are chained through their high field
+        uint32_t index = arena->free_list;
+        arena->free_list = arena->slabs[index >> ARENA_SLAB_BITS][index & ARENA_SLAB_MASK].high;
+        if (++arena->in_use > arena->peak) arena->peak = arena->in_use;
+        return index << 1;
     }
 
-    BDDNode *high, *low;
-    if (exists) {
-        if (negated) {
-            high = create_terminal_node(bdd, '0');  // If negated var is 1, term fails
-            low = build_term_bdd(bdd, term, var_index + 1);  // If 0, continue
-        } else {
-            high = build_term_bdd(bdd, term, var_index + 1);  // If var is 1, continue
-            low = create_terminal_node(bdd, '0');  // If 0, term fails
+    uint32_t index = arena->next;
+    if ((index >> ARENA_SLAB_BITS) == (uint32_t)arena->slab_count) {
+        if (!bdd_memory_reserve(ARENA_SLAB_SIZE * sizeof(BDDNode), capped)) return BDD_NONE;
+        BDDNode *slab = malloc(ARENA_SLAB_SIZE * sizeof(BDDNode));
+        if (!slab) {
+            bdd_memory_release(ARENA_SLAB_SIZE * sizeof(BDDNode));
+            return BDD_NONE;
         }
-    } else {
-        // Variable not in term - continue with both branches
-        BDDNode *child = build_term_bdd(bdd, term, var_index + 1);
-        high = low = child;
+        if (arena->slab_count == arena->slab_capacity) {
+            arena->slab_capacity *= 2;
+            if (arena->shared) {
+                // Readers on other threads may still hold the old directory,
+                // so it is kept until the parallel apply ends
+                BDDNode **slabs = malloc(arena->slab_capacity * sizeof(BDDNode*));
+                memcpy(slabs, arena->slabs, arena->slab_count * sizeof(BDDNode*));
+                arena->retired = realloc(arena->retired, (arena->retired_count + 1) * sizeof(BDDNode**));
+                arena->retired[arena->retired_count++] = arena->slabs;
+                __atomic_store_n(&arena->slabs, slabs, __ATOMIC_RELEASE);
+            } else {
+                arena->slabs = realloc(arena->slabs, arena->slab_capacity * sizeof(BDDNode*));
+            }
+        }
+        arena->slabs[arena->slab_count++] = slab;
     }
+    arena->next++;
+    if (++arena->in_use > arena->peak) arena->peak = arena->in_use;
+    return index << 1;
+}
 
-    return find_or_create_node(bdd, current_var, var_index, high, low);
+// Frees the slab directories replaced while the arena was shared
+static void arena_free_retired(NodeArena *arena) {
+    for (int i = 0; i < arena->retired_count; i++)
+        free(arena->retired[i]);
+    free(arena->retired);
+    arena->retired = NULL;
+    arena->retired_count = 0;
 }
 
-BDDNode* bdd_or(BDD *bdd, BDDNode *f, BDDNode *g) {
-    // Terminal cases
-    if (f->is_terminal) return f->value == '1' ? f : g;
-    if (g->is_terminal) return g->value == '1' ? g : f;
+void arena_free(NodeArena *arena) {
+    for (int i = 0; i < arena->slab_count; i++)
+        free(arena->slabs[i]);
+    bdd_memory_release((size_t)arena->slab_count * ARENA_SLAB_SIZE * sizeof(BDDNode));
+    free(arena->slabs);
+    arena_free_retired(arena);
+}
 
-    // Same variable - merge branches
-    if (f->var_index == g->var_index) {
-        BDDNode *high = bdd_or(bdd, f->high, g->high);
-        BDDNode *low = bdd_or(bdd, f->low, g->low);
-        return find_or_create_node(bdd, f->var_name, f->var_index, high, low);
-    }
+// -------------------- Unique Table --------------------
+static inline uint32_t unique_hash(BDDRef high, BDDRef low) {
+    uint64_t h = (uint64_t)high * 0x9E3779B97F4A7C15ULL;
+    h ^= (uint64_t)low * 0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 29;
+    return (uint32_t)h;
+}
 
-    // Different variables - f comes first in order
-    if (f->var_index < g->var_index) {
-        BDDNode *high = bdd_or(bdd, f->high, g);
-        BDDNode *low = bdd_or(bdd, f->low, g);
-        return find_or_create_node(bdd, f->var_name, f->var_index, high, low);
+void unique_init(UniqueTable *table, int level_count) {
+    table->level_count = level_count;
+    table->size = 0;
+    table->levels = malloc((level_count > 0 ? level_count : 1) * sizeof(UniqueSubtable));
+    for (int i = 0; i < level_count; i++) {
+        table->levels[i].capacity = UNIQUE_INITIAL_CAPACITY;
+        table->levels[i].size = 0;
+        table->levels[i].buckets = calloc(UNIQUE_INITIAL_CAPACITY, sizeof(BDDRef));
     }
-    
-    // g comes first in order
-    BDDNode *high = bdd_or(bdd, f, g->high);
-    BDDNode *low = bdd_or(bdd, f, g->low);
-    return find_or_create_node(bdd, g->var_name, g->var_index, high, low);
+    bdd_memory_charge((size_t)level_count * UNIQUE_INITIAL_CAPACITY * sizeof(BDDRef));
 }
 
-// In BDD_use(), add input validation:
-char BDD_use(BDD *bdd, const char *inputs) {
+// Doubles a subtable. Returns false, leaving it as it was, if the new
+// buckets cannot be allocated or, when `capped`, would pass the memory cap.
+static bool unique_grow(BDD *bdd, UniqueSubtable *sub, bool capped) {
+    uint32_t old_capacity = sub->capacity;
+    BDDRef *old_buckets = sub->buckets;
+
+    if (!bdd_memory_reserve(2 * old_capacity * sizeof(BDDRef), capped)) return false;
+    BDDRef *buckets = calloc(2 * old_capacity, sizeof(BDDRef));
+    if (!buckets) {
+        bdd_memory_release(2 * old_capacity * sizeof(BDDRef));
+        return false;
+    }
+    sub->capacity = old_capacity * 2;
+    sub->buckets = buckets;
+
+    uint32_t mask = sub->capacity - 1;
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (old_buckets[i] == BDD_NONE) continue;
+        BDDNode *node = bdd_node(bdd, old_buckets[i]);
+        uint32_t slot = unique_hash(node->high, node->low) & mask;
+        while (sub->buckets[slot] != BDD_NONE) slot = (slot + 1) & mask;
+        sub->buckets[slot] = old_buckets[i];
+    }
+    free(old_buckets);
+    bdd_memory_release(old_capacity * sizeof(BDDRef));
+    return true;
+}
+
+// Adds a node that is known not to be in its level's subtable yet
+static void unique_insert(BDD *bdd, uint32_t level, BDDRef ref) {
+    UniqueSubtable *sub = &bdd->unique.levels[level];
+    if ((sub->size + 1) * UNIQUE_MAX_LOAD_DEN > sub->capacity * UNIQUE_MAX_LOAD_NUM) {
+        unique_grow(bdd, sub, false);
+    }
+    BDDNode *node = bdd_node(bdd, ref);
+    uint32_t mask = sub->capacity - 1;
+    uint32_t slot = unique_hash(node->high, node->low) & mask;
+    while (sub->buckets[slot] != BDD_NONE) slot = (slot + 1) & mask;
+    sub->buckets[slot] = ref;
+    sub->size++;
+    bdd->unique.size++;
+}
+
+static void unique_remove(BDD *bdd, BDDRef ref) {
+    BDDNode *node = bdd_node(bdd, ref);
+    UniqueSubtable *sub = &bdd->unique.levels[node->level];
+    uint32_t mask = sub->capacity - 1;
+    uint32_t hole = unique_hash(node->high, node->low) & mask;
+    while (sub->buckets[hole] != ref) hole = (hole + 1) & mask;
+
+    // Backward-shift deletion: pull later entries of the probe run into the
+    // hole unless that would move them in front of their home slot
+    for (uint32_t next = (hole + 1) & mask; sub->buckets[next] != BDD_NONE; next = (next + 1) & mask) {
+        BDDNode *moved = bdd_node(bdd, sub->buckets[next]);
+        uint32_t home = unique_hash(moved->high, moved->low) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            sub->buckets[hole] = sub->buckets[next];
+            hole = next;
+        }
+    }
+    sub->buckets[hole] = BDD_NONE;
+    sub->size--;
+    bdd->unique.size--;
+}
+
+// Appends an empty subtable for a new bottom level
+static void unique_add_level(UniqueTable *table) {
+    table->levels = realloc(table->levels, (table->level_count + 1) * sizeof(UniqueSubtable));
+    UniqueSubtable *sub = &table->levels[table->level_count++];
+    sub->capacity = UNIQUE_INITIAL_CAPACITY;
+    sub->size = 0;
+    sub->buckets = calloc(UNIQUE_INITIAL_CAPACITY, sizeof(BDDRef));
+    bdd_memory_charge(UNIQUE_INITIAL_CAPACITY * sizeof(BDDRef));
+}
+
+void unique_free(UniqueTable *table) {
+    for (int i = 0; i < table->level_count; i++) {
+        free(table->levels[i].buckets);
+        bdd_memory_release(table->levels[i].capacity * sizeof(BDDRef));
+    }
+    free(table->levels);
+}
+
+// -------------------- Computed Table --------------------
+void computed_init(ComputedTable *cache, int size) {
+    int pow2 = 1;
+    while (pow2 < size) pow2 <<= 1;
+    cache->size = pow2;
+    cache->entries = calloc(pow2, sizeof(CacheEntry));
+    cache->generation = 0;
+    cache->hits = cache->misses = 0;
+    cache->locks = NULL;
+#if BDD_STATS
+    memset(cache->op_hits, 0, sizeof(cache->op_hits));
+    memset(cache->op_misses, 0, sizeof(cache->op_misses));
+#endif
+}
+
+void computed_free(ComputedTable *cache) {
+    free(cache->entries);
+    cache->entries = NULL;
+}
+
+static inline CacheEntry* computed_slot(ComputedTable *cache, int op, BDDRef f, BDDRef g, BDDRef h) {
+    uint64_t x = (uint64_t)f * 0x9E3779B97F4A7C15ULL;
+    x ^= (uint64_t)g * 0xC2B2AE3D27D4EB4FULL;
+    x ^= (uint64_t)h * 0xD6E8FEB86659FD93ULL;
+    x ^= (uint64_t)op * 0x165667B19E3779F9ULL;
+    x ^= x >> 31;
+    return &cache->entries[x & (cache->size - 1)];
+}
+
+// While a parallel apply runs, entries are guarded by striped spinlocks:
+// an entry spans several words, and a torn read could pair the key of one
+// call with the result of another
+#define CACHE_LOCK_STRIPES 1024
+
+static inline unsigned char* computed_lock(ComputedTable *cache, const CacheEntry *entry) {
+    if (!cache->locks) return NULL;
+    unsigned char *lock = &cache->locks[(entry - cache->entries) & (CACHE_LOCK_STRIPES - 1)];
+    while (__atomic_test_and_set(lock, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(lock, __ATOMIC_RELAXED)) sched_yield();
+    }
+    return lock;
+}
+
+static inline void computed_unlock(unsigned char *lock) {
+    if (lock) __atomic_clear(lock, __ATOMIC_RELEASE);
+}
+
+static inline void computed_count(const ComputedTable *cache, unsigned long *counter) {
+    if (cache->locks) __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+    else (*counter)++;
+}
+
+// Key word of an entry stored now; entries from earlier generations never
+// match it
+static inline uint32_t computed_tag(const ComputedTable *cache, int op) {
+    return cache->generation << 8 | (uint32_t)op;
+}
+
+BDDRef computed_lookup(ComputedTable *cache, int op, BDDRef f, BDDRef g, BDDRef h) {
+    CacheEntry *entry = computed_slot(cache, op, f, g, h);
+    unsigned char *lock = computed_lock(cache, entry);
+    BDDRef result = BDD_NONE;
+    if (entry->result != BDD_NONE && entry->op == computed_tag(cache, op) &&
+        entry->f == f && entry->g == g && entry->h == h) {
+        result = entry->result;
+    }
+    computed_unlock(lock);
+
+    if (result != BDD_NONE) {
+        computed_count(cache, &cache->hits);
+#if BDD_STATS
+        computed_count(cache, &cache->op_hits[op]);
+#endif
+        return result;
+    }
+    computed_count(cache, &cache->misses);
+#if BDD_STATS
+    computed_count(cache, &cache->op_misses[op]);
+#endif
+    return BDD_NONE;
+}
+
+void computed_insert(ComputedTable *cache, int op, BDDRef f, BDDRef g, BDDRef h, BDDRef result) {
+    CacheEntry *entry = computed_slot(cache, op, f, g, h);
+    unsigned char *lock = computed_lock(cache, entry);
+    entry->op = computed_tag(cache, op);
+    entry->f = f;
+    entry->g = g;
+    entry->h = h;
+    entry->result = result;
+    computed_unlock(lock);
+}
+
+// Drops every memoized result, e.g. after nodes were released. Starting a
+// new generation is O(1); the entries are only wiped once the 24-bit
+// generation wraps around.
+void computed_clear(ComputedTable *cache) {
+    if (++cache->generation < 1u << 24) return;
+    memset(cache->entries, 0, cache->size * sizeof(CacheEntry));
+    cache->generation = 0;
+}
+
+// Replaces the computed table of an existing BDD, dropping all memoized results.
+void BDD_cache_resize(BDD *bdd, int entries) {
+    computed_free(&bdd->cache);
+    computed_init(&bdd->cache, entries);
+}
+
+void BDD_cache_stats(const BDD *bdd, unsigned long *hits, unsigned long *misses) {
+    if (hits) *hits = bdd->cache.hits;
+    if (misses) *misses = bdd->cache.misses;
+}
+
+// -------------------- Statistics --------------------
+static const char *const bdd_op_names[OP_COUNT] = {"ite", "or_cube", "restrict", "exists"};
+static const char *const bdd_phase_names[BDD_PHASE_COUNT] = {
+    "parse", "terms", "or", "order_search", "gc", "reorder",
+};
+
+// Monotonic wall clock in nanoseconds
+static uint64_t bdd_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+// Time recorded in all phases so far; 0 without BDD_STATS
+static inline uint64_t bdd_phase_total(const BDD *bdd) {
+    uint64_t total = 0;
+#if BDD_STATS
+    for (int p = 0; p < BDD_PHASE_COUNT; p++) total += bdd->stats.phase_ns[p];
+#else
+    (void)bdd;
+#endif
+    return total;
+}
+
+void BDD_get_stats(const BDD *bdd, BDDStats *out) {
+    memset(out, 0, sizeof(BDDStats));
+#if BDD_STATS
+    *out = bdd->stats;
+    out->enabled = true;
+    for (int op = 0; op < OP_COUNT; op++) {
+        out->op_cache_hits[op] = bdd->cache.op_hits[op];
+        out->op_cache_misses[op] = bdd->cache.op_misses[op];
+    }
+#endif
+    out->live_nodes = bdd->unique.size - bdd->dead_nodes;
+    out->dead_nodes = bdd->dead_nodes;
+    out->peak_nodes = bdd->arena.peak;
+    out->cache_hits = bdd->cache.hits;
+    out->cache_misses = bdd->cache.misses;
+}
+
+// Zeroes the counters, e.g. to measure one operation on its own. The peak
+// restarts from the current arena size.
+void BDD_reset_stats(BDD *bdd) {
+#if BDD_STATS
+    memset(&bdd->stats, 0, sizeof(BDDStats));
+    memset(bdd->cache.op_hits, 0, sizeof(bdd->cache.op_hits));
+    memset(bdd->cache.op_misses, 0, sizeof(bdd->cache.op_misses));
+#endif
+    bdd->cache.hits = bdd->cache.misses = 0;
+    bdd->arena.peak = bdd->arena.in_use;
+}
+
+// Writes the statistics as one JSON object
+void BDD_stats_json(const BDD *bdd, FILE *out) {
+    BDDStats stats;
+    BDD_get_stats(bdd, &stats);
+    unsigned long lookups = stats.cache_hits + stats.cache_misses;
+    fprintf(out, "{\"enabled\": %s, \"live_nodes\": %u, \"dead_nodes\": %u, \"peak_nodes\": %u, "
+                 "\"cache\": {\"hits\": %lu, \"misses\": %lu, \"hit_rate\": %.4f",
+            stats.enabled ? "true" : "false", stats.live_nodes, stats.dead_nodes, stats.peak_nodes, stats.cache_hits,
+            stats.cache_misses, lookups ? (double)stats.cache_hits / lookups : 0.0);
+    if (!stats.enabled) {
+        fprintf(out, "}}");
+        return;
+    }
+
+    fprintf(out, ", \"ops\": {");
+    for (int op = 0; op < OP_COUNT; op++) {
+        fprintf(out, "%s\"%s\": {\"hits\": %llu, \"misses\": %llu}", op ? ", " : "", bdd_op_names[op],
+                (unsigned long long)stats.op_cache_hits[op], (unsigned long long)stats.op_cache_misses[op]);
+    }
+    fprintf(out, "}}, \"unique\": {\"lookups\": %llu, \"hits\": %llu, \"probes\": %llu, "
+                 "\"avg_probe\": %.3f, \"max_probe\": %u}, \"nodes_allocated\": %llu, \"max_depth\": %d, "
+                 "\"gc\": {\"runs\": %llu, \"freed\": %llu}, \"reorder\": {\"sifts\": %llu, \"swaps\": %llu}, "
+                 "\"phase_ns\": {",
+            (unsigned long long)stats.unique_lookups, (unsigned long long)stats.unique_hits,
+            (unsigned long long)stats.unique_probes,
+            stats.unique_lookups ? (double)stats.unique_probes / stats.unique_lookups : 0.0,
+            stats.unique_max_probe, (unsigned long long)stats.nodes_allocated, stats.max_depth,
+            (unsigned long long)stats.gc_runs, (unsigned long long)stats.gc_freed,
+            (unsigned long long)stats.sift_runs, (unsigned long long)stats.level_swaps);
+    for (int p = 0; p < BDD_PHASE_COUNT; p++) {
+        fprintf(out, "%s\"%s\": %llu", p ? ", " : "", bdd_phase_names[p], (unsigned long long)stats.phase_ns[p]);
+    }
+    fprintf(out, "}}");
+}
+
+// -------------------- BDD Creation --------------------
+BDDRef create_terminal_node(BDD *bdd, char value) {
+    (void)bdd; // The terminal lives in a fixed arena slot
+    return value == '1' ? BDD_ONE : BDD_ZERO;
+}
+
+// -------------------- Traversal --------------------
+// Depth-first walks with an explicit stack, so deep BDDs cannot overflow
+// the call stack. Visited nodes are stamped with the current epoch rather
+// than flagged, so no pass is needed to clear marks before or after.
+typedef void (*BDDVisitor)(BDD *bdd, BDDRef node, void *context);
+
+typedef struct
+{
+    BDDRef ref;
+    int next; // 0 before the high child, 1 before the low child, 2 done
+} TraversalFrame;
+
+// Starts a new epoch, sizing the stamps to the arena
+static void bdd_begin_visit(BDD *bdd) {
+    uint32_t size = bdd->arena.next;
+    if (bdd->visit_size < size) {
+        bdd->visit = realloc(bdd->visit, size * sizeof(uint32_t));
+        memset(bdd->visit + bdd->visit_size, 0, (size - bdd->visit_size) * sizeof(uint32_t));
+        bdd->visit_size = size;
+    }
+    if (++bdd->epoch == 0) {
+        // After 2^32 walks old stamps could match again
+        memset(bdd->visit, 0, bdd->visit_size * sizeof(uint32_t));
+        bdd->epoch = 1;
+    }
+}
+
+static inline bool bdd_first_visit(BDD *bdd, BDDRef ref) {
+    uint32_t *stamp = &bdd->visit[ref >> 1];
+    if (*stamp == bdd->epoch) return false;
+    *stamp = bdd->epoch;
+    return true;
+}
+
+// Visits every node reachable from the roots once, terminal included, and
+// returns how many there were. `pre` sees a node before anything below
+// it, `post` after both of its children, so a post-order visitor can
+// compute bottom-up results in one pass; either may be NULL. Nodes are
+// passed as regular handles. Visitors must not create nodes.
+int bdd_traverse(BDD *bdd, const BDDRef *roots, int root_count, BDDVisitor pre, BDDVisitor post,
+                 void *context) {
+    bdd_begin_visit(bdd);
+    // Each frame sits strictly below the one before it, so the stack never
+    // holds more than one frame per level plus the terminal
+    TraversalFrame *stack = malloc((bdd->var_count + 2) * sizeof(TraversalFrame));
+    int count = 0;
+
+    for (int r = 0; r < root_count; r++) {
+        BDDRef root = BDD_REGULAR(roots[r]);
+        if (!bdd_first_visit(bdd, root)) continue;
+        if (pre) pre(bdd, root, context);
+        stack[0] = (TraversalFrame){root, 0};
+        int depth = 1;
+        count++;
+
+        while (depth > 0) {
+            TraversalFrame *frame = &stack[depth - 1];
+            BDDNode *node = bdd_node(bdd, frame->ref);
+            if (node->level == BDD_TERMINAL_LEVEL || frame->next == 2) {
+                if (post) post(bdd, frame->ref, context);
+                depth--;
+                continue;
+            }
+            BDDRef child = BDD_REGULAR(frame->next++ == 0 ? node->high : node->low);
+            if (!bdd_first_visit(bdd, child)) continue;
+            if (pre) pre(bdd, child, context);
+            stack[depth++] = (TraversalFrame){child, 0};
+            count++;
+        }
+    }
+
+    free(stack);
+    return count;
+}
+
+// Counts the nodes reachable from the root, terminal included
+void update_node_count(BDD *bdd) {
+    bdd->node_count = bdd_traverse(bdd, &bdd->root, 1, NULL, NULL, NULL);
+}
+
+static inline void bdd_work_push(BDD *bdd, int *top, BDDRef ref) {
+    if (BDD_IS_TERMINAL(ref)) return;
+    if (*top == bdd->work_capacity) {
+        bdd->work_capacity = bdd->work_capacity ? 2 * bdd->work_capacity : 64;
+        bdd->work = realloc(bdd->work, bdd->work_capacity * sizeof(BDDRef));
+    }
+    bdd->work[(*top)++] = ref;
+}
+
+// Takes a reference on a node. A dead node comes back to life and takes
+// its references on its children back, which may revive them in turn.
+static void bdd_ref_node(BDD *bdd, BDDRef ref) {
+    if (BDD_IS_TERMINAL(ref)) return;
+    int top = 0;
+    bdd_work_push(bdd, &top, ref);
+    while (top > 0) {
+        BDDNode *node = bdd_node(bdd, bdd->work[--top]);
+        if (node->ref++ > 0) continue;
+        bdd->dead_nodes--;
+        BDDRef high = node->high, low = node->low;
+        bdd_work_push(bdd, &top, high);
+        bdd_work_push(bdd, &top, low);
+    }
+}
+
+// Drops a reference without freeing anything. A node left without any is
+// dead until the next collection and gives up its references on its
+// children, so everything only it kept alive is counted as dead too.
+static void bdd_unref_node(BDD *bdd, BDDRef ref) {
+    if (BDD_IS_TERMINAL(ref)) return;
+    int top = 0;
+    bdd_work_push(bdd, &top, ref);
+    while (top > 0) {
+        BDDNode *node = bdd_node(bdd, bdd->work[--top]);
+        if (--node->ref > 0) continue;
+        bdd->dead_nodes++;
+        BDDRef high = node->high, low = node->low;
+        bdd_work_push(bdd, &top, high);
+        bdd_work_push(bdd, &top, low);
+    }
+}
+
+// Protects `result` and drops the protection on `previous`: the step that
+// carries a partial result from one construction step to the next
+static inline BDDRef bdd_keep(BDD *bdd, BDDRef previous, BDDRef result) {
+    bdd_ref_node(bdd, result);
+    bdd_unref_node(bdd, previous);
+    return result;
+}
+
+// Nodes reachable from a protected root, terminal excluded, in O(1)
+static inline int bdd_live_nodes(const BDD *bdd) {
+    return bdd->unique.size - bdd->dead_nodes;
+}
+
+static inline bool bdd_aborted(const BDD *bdd) {
+    return __atomic_load_n(&bdd->aborted, __ATOMIC_RELAXED) != BDD_ABORT_NONE;
+}
+
+// Stops the running construction instead of creating a node. From then on
+// every apply returns BDD_ZERO at once, so the builder unwinds quickly and
+// finds out in bdd_end_build. Outside a construction nothing can be
+// stopped, and running out of memory is fatal as before.
+static BDDRef bdd_abort(BDD *bdd, BDDAbort reason, pthread_mutex_t *level_lock) {
+    if (level_lock) pthread_mutex_unlock(level_lock);
+    if (!bdd->abortable) {
+        fprintf(stderr, "BDD: out of memory\n");
+        abort();
+    }
+    int none = BDD_ABORT_NONE;
+    __atomic_compare_exchange_n(&bdd->aborted, &none, reason, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    return BDD_ZERO;
+}
+
+BDDRef find_or_create_node(BDD *bdd, uint32_t level, BDDRef high, BDDRef low) {
+    // Eliminate redundant nodes (1st reduction)
+    if (high == low) {
+        return high;
+    }
+
+    // Keep the high edge regular; a complemented high edge is pushed up
+    // onto the returned edge instead
+    if (BDD_IS_COMPLEMENT(high)) {
+        return BDD_NOT(find_or_create_node(bdd, level, BDD_NOT(high), BDD_NOT(low)));
+    }
+
+    // During a parallel apply each subtable has its own lock, and nodes are
+    // allocated under a lock of their own
+    pthread_mutex_t *level_lock = bdd->parallel ? &bdd->pool->level_locks[level] : NULL;
+    if (level_lock) pthread_mutex_lock(level_lock);
+
+    // Check for existing isomorphic nodes (2nd reduction)
+    UniqueSubtable *sub = &bdd->unique.levels[level];
+    uint32_t mask = sub->capacity - 1;
+    uint32_t slot = unique_hash(high, low) & mask;
+    uint32_t probes = 1;
+    BDD_STAT_ADD(bdd, unique_lookups, 1);
+    for (BDDRef ref; (ref = sub->buckets[slot]) != BDD_NONE; slot = (slot + 1) & mask, probes++) {
+        BDDNode *node = bdd_node(bdd, ref);
+        if (node->high == high && node->low == low) {
+            BDD_STAT_ADD(bdd, unique_hits, 1);
+            BDD_STAT_ADD(bdd, unique_probes, probes);
+            BDD_STAT_MAX(bdd, unique_max_probe, probes);
+            if (level_lock) pthread_mutex_unlock(level_lock);
+            return ref;
+        }
+    }
+    BDD_STAT_ADD(bdd, unique_probes, probes);
+    BDD_STAT_MAX(bdd, unique_max_probe, probes);
+
+    // Rehash first if the insert would overload the subtable
+    if ((sub->size + 1) * UNIQUE_MAX_LOAD_DEN > sub->capacity * UNIQUE_MAX_LOAD_NUM) {
+        if (!unique_grow(bdd, sub, bdd->abortable)) return bdd_abort(bdd, BDD_ABORT_MEMORY, level_lock);
+        mask = sub->capacity - 1;
+        slot = unique_hash(high, low) & mask;
+        while (sub->buckets[slot] != BDD_NONE) slot = (slot + 1) & mask;
+    }
+
+    // Create new node. Apart from the cube chains bdd_or_cube leaves out of
+    // the count, every node an apply creates ends up in its result, so a
+    // construction that has created more nodes since its last checkpoint
+    // than the limit allows would end up over it.
+    if (level_lock) pthread_mutex_lock(&bdd->pool->alloc_lock);
+    BDDAbort abort_reason = BDD_ABORT_NONE;
+    BDDRef ref = BDD_NONE;
+    if (bdd->abortable && bdd->node_limit > 0 && bdd->unique.size - bdd->checkpoint_size >= bdd->node_limit) {
+        abort_reason = BDD_ABORT_NODES;
+    } else if ((ref = arena_alloc(&bdd->arena, bdd->abortable)) == BDD_NONE) {
+        abort_reason = BDD_ABORT_MEMORY;
+    } else {
+        bdd->node_count++;
+        bdd->dead_nodes++; // until a parent or a caller takes a reference, which
+                           // also makes it reference its children
+        bdd->unique.size++;
+    }
+    if (level_lock) pthread_mutex_unlock(&bdd->pool->alloc_lock);
+    if (abort_reason != BDD_ABORT_NONE) return bdd_abort(bdd, abort_reason, level_lock);
+
+    BDD_STAT_ADD(bdd, nodes_allocated, 1);
+    BDDNode *node = bdd_node(bdd, ref);
+    node->level = level;
+    node->high = high;
+    node->low = low;
+    node->ref = 0;
+    sub->buckets[slot] = ref;
+    sub->size++;
+    if (level_lock) pthread_mutex_unlock(level_lock);
+    
+    return ref;
+}
+
+// Top level of a possibly complemented edge; terminals report BDD_TERMINAL_LEVEL
+static inline uint32_t bdd_level(const BDD *bdd, BDDRef f) {
+    return bdd_node(bdd, f)->level;
+}
+
+// Cofactor of f with respect to the variable at `level`, propagating the
+// complement bit of the incoming edge onto the children
+static inline BDDRef bdd_cofactor(const BDD *bdd, BDDRef f, uint32_t level, bool positive) {
+    BDDNode *node = bdd_node(bdd, f);
+    if (node->level != level) return f;
+    BDDRef child = positive ? node->high : node->low;
+    return BDD_IS_COMPLEMENT(f) ? BDD_NOT(child) : child;
+}
+
+// Orders two operands of a commutative operation: higher in the variable
+// order first, then by handle, so equivalent calls share a cache entry.
+static inline bool bdd_precedes(const BDD *bdd, BDDRef a, BDDRef b) {
+    uint32_t la = bdd_level(bdd, a), lb = bdd_level(bdd, b);
+    if (la != lb) return la < lb;
+    return a < b;
+}
+
+// Settles the terminal cases of ite(f, g, h) and returns their result.
+// Otherwise rewrites the call into its standard triple, whose result is
+// to be complemented if *negate is set, and returns BDD_NONE.
+static inline BDDRef bdd_ite_standardize(const BDD *bdd, BDDRef *pf, BDDRef *pg, BDDRef *ph, bool *negate) {
+    BDDRef f = *pf, g = *pg, h = *ph;
+    *negate = false;
+
+    // Terminal cases
+    if (f == BDD_ONE) return g;
+    if (f == BDD_ZERO) return h;
+
+    // Replace references to f inside g and h by constants
+    if (g == f) g = BDD_ONE;
+    else if (g == BDD_NOT(f)) g = BDD_ZERO;
+    if (h == f) h = BDD_ZERO;
+    else if (h == BDD_NOT(f)) h = BDD_ONE;
+
+    if (g == h) return g;
+    if (g == BDD_ONE && h == BDD_ZERO) return f;
+    if (g == BDD_ZERO && h == BDD_ONE) return BDD_NOT(f);
+
+    // Rewrite commutative forms into one standard triple
+    if (g == BDD_ONE) {                      // f + h
+        if (bdd_precedes(bdd, h, f)) { BDDRef t = f; f = h; h = t; }
+    } else if (h == BDD_ZERO) {              // f * g
+        if (bdd_precedes(bdd, g, f)) { BDDRef t = f; f = g; g = t; }
+    } else if (g == BDD_ZERO) {              // !f * h == ite(!h, 0, !f)
+        if (bdd_precedes(bdd, h, f)) { BDDRef t = f; f = BDD_NOT(h); h = BDD_NOT(t); }
+    } else if (h == BDD_ONE) {               // !f + g == ite(!g, !f, 1)
+        if (bdd_precedes(bdd, g, f)) { BDDRef t = f; f = BDD_NOT(g); g = BDD_NOT(t); }
+    } else if (g == BDD_NOT(h)) {            // f xor h == ite(h, !f, f)
+        if (bdd_precedes(bdd, h, f)) { BDDRef t = f; f = h; g = BDD_NOT(t); h = t; }
+    }
+
+    // Make f and g regular so complemented calls share entries
+    if (BDD_IS_COMPLEMENT(f)) {
+        BDDRef t = g; g = h; h = t;
+        f = BDD_NOT(f);
+    }
+    if (BDD_IS_COMPLEMENT(g)) {
+        g = BDD_NOT(g);
+        h = BDD_NOT(h);
+        *negate = true;
+    }
+
+    *pf = f;
+    *pg = g;
+    *ph = h;
+    return BDD_NONE;
+}
+
+// Level the recursion of a standard ITE triple splits on
+static inline uint32_t bdd_ite_top(const BDD *bdd, BDDRef f, BDDRef g, BDDRef h) {
+    uint32_t top = bdd_level(bdd, f);
+    if (bdd_level(bdd, g) < top) top = bdd_level(bdd, g);
+    if (bdd_level(bdd, h) < top) top = bdd_level(bdd, h);
+    return top;
+}
+
+BDDRef bdd_ite(BDD *bdd, BDDRef f, BDDRef g, BDDRef h) {
+    bool negate;
+    BDDRef result = bdd_ite_standardize(bdd, &f, &g, &h, &negate);
+    if (result != BDD_NONE) return result;
+    if (bdd_aborted(bdd)) return BDD_ZERO;
+
+    result = computed_lookup(&bdd->cache, OP_ITE, f, g, h);
+    if (result == BDD_NONE) {
+        BDD_STAT_ENTER(bdd);
+        uint32_t top = bdd_ite_top(bdd, f, g, h);
+
+        BDDRef high = bdd_ite(bdd, bdd_cofactor(bdd, f, top, true), bdd_cofactor(bdd, g, top, true),
+                              bdd_cofactor(bdd, h, top, true));
+        BDDRef low = bdd_ite(bdd, bdd_cofactor(bdd, f, top, false), bdd_cofactor(bdd, g, top, false),
+                             bdd_cofactor(bdd, h, top, false));
+        result = find_or_create_node(bdd, top, high, low);
+        computed_insert(&bdd->cache, OP_ITE, f, g, h, result);
+        BDD_STAT_LEAVE(bdd);
+    }
+
+    return negate ? BDD_NOT(result) : result;
+}
+
+BDDRef bdd_not(BDDRef f) {
+    return BDD_NOT(f);
+}
+
+BDDRef bdd_and(BDD *bdd, BDDRef f, BDDRef g) {
+    return bdd_ite(bdd, f, g, BDD_ZERO);
+}
+
+BDDRef bdd_or(BDD *bdd, BDDRef f, BDDRef g) {
+    return bdd_ite(bdd, f, BDD_ONE, g);
+}
+
+BDDRef bdd_xor(BDD *bdd, BDDRef f, BDDRef g) {
+    return bdd_ite(bdd, f, BDD_NOT(g), g);
+}
+
+BDDRef bdd_implies(BDD *bdd, BDDRef f, BDDRef g) {
+    return bdd_ite(bdd, f, g, BDD_ONE);
+}
+
+// Recursive step of bdd_or_cube: ORs the cube suffix starting at lits[i],
+// whose canonical chain is chain[i], into f
+static BDDRef bdd_or_cube_rec(BDD *bdd, BDDRef f, const Variable *lits, const BDDRef *chain,
+                              int count, int i) {
+    if (i == count || f == BDD_ONE) return BDD_ONE;
+    if (f == BDD_ZERO) return chain[i];
+    if (bdd_aborted(bdd)) return BDD_ZERO;
+
+    BDDRef result = computed_lookup(&bdd->cache, OP_OR_CUBE, f, chain[i], BDD_NONE);
+    if (result != BDD_NONE) return result;
+
+    BDD_STAT_ENTER(bdd);
+    uint32_t f_level = bdd_level(bdd, f);
+    uint32_t lit_level = bdd->var_level[lits[i].var];
+
+    if (f_level < lit_level) {
+        // f branches above the next literal: the cube applies to both sides
+        BDDRef high = bdd_or_cube_rec(bdd, bdd_cofactor(bdd, f, f_level, true), lits, chain, count, i);
+        BDDRef low = bdd_or_cube_rec(bdd, bdd_cofactor(bdd, f, f_level, false), lits, chain, count, i);
+        result = find_or_create_node(bdd, f_level, high, low);
+    } else {
+        // The literal's failing branch leaves f (or its cofactor) untouched
+        BDDRef f_high = bdd_cofactor(bdd, f, lit_level, true);
+        BDDRef f_low = bdd_cofactor(bdd, f, lit_level, false);
+        if (lits[i].negated) {
+            f_low = bdd_or_cube_rec(bdd, f_low, lits, chain, count, i + 1);
+        } else {
+            f_high = bdd_or_cube_rec(bdd, f_high, lits, chain, count, i + 1);
+        }
+        result = find_or_create_node(bdd, lit_level, f_high, f_low);
+    }
+
+    computed_insert(&bdd->cache, OP_OR_CUBE, f, chain[i], BDD_NONE, result);
+    BDD_STAT_LEAVE(bdd);
+    return result;
+}
+
+// ORs the cube lits[0..count), sorted by level, into f. Only the levels the
+// cube mentions and the part of f above them are visited; everything else
+// is shared with f.
+BDDRef bdd_or_cube(BDD *bdd, BDDRef f, const Variable *lits, int count) {
+    // chain[i] is the cube of lits[i..count), built bottom-up in O(count).
+    // It gives each recursion step a canonical cache key.
+    BDDRef *chain = malloc((count + 1) * sizeof(BDDRef));
+    chain[count] = BDD_ONE;
+    // Where f already covers a suffix of the cube its chain nodes are dead
+    // at once, so they do not count against the node limit; the next
+    // checkpoint still counts those the result keeps
+    int node_limit = bdd->node_limit, table_size = bdd->unique.size;
+    bdd->node_limit = 0;
+    for (int i = count - 1; i >= 0; i--) {
+        uint32_t level = bdd->var_level[lits[i].var];
+        chain[i] = lits[i].negated ? find_or_create_node(bdd, level, BDD_ZERO, chain[i + 1])
+                                   : find_or_create_node(bdd, level, chain[i + 1], BDD_ZERO);
+    }
+    bdd->node_limit = node_limit;
+    bdd->checkpoint_size += bdd->unique.size - table_size;
+
+    BDDRef result = bdd_or_cube_rec(bdd, f, lits, chain, count, 0);
+    free(chain);
+    return result;
+}
+
+// -------------------- Parallel Apply --------------------
+// A BDD created with parallel_apply and more than one thread keeps a pool
+// of workers that split large ORs: above APPLY_MIN_LEVELS levels and
+// within the first APPLY_FORK_DEPTH steps, the high half of an ITE step is
+// pushed as a task that idle threads steal while the caller computes the
+// low half. While the pool runs, the unique table locks one subtable per
+// level, the arena allocates under a lock, and the computed table locks
+// stripes of entries. The unique table still holds one node per function,
+// so the result is the same node bdd_or returns. Collection and
+// reordering only happen at checkpoints, never during an apply.
+//
+// Every node lookup and creation takes those locks, which so far costs
+// more than the split saves, so the pool is opt-in rather than implied by
+// the thread count.
+#define APPLY_FORK_DEPTH 12
+#define APPLY_MIN_LEVELS 8
+#define APPLY_MIN_OPERAND 1024 // ORs with a smaller operand run on the calling thread
+
+static bool apply_steal(ApplyPool *pool, int self);
+
+static void apply_push(ApplyPool *pool, int self, ApplyTask *task) {
+    ApplyDeque *deque = &pool->deques[self];
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom == deque->capacity) {
+        // Stolen tasks leave room at the top
+        memmove(deque->tasks, deque->tasks + deque->top, (deque->bottom - deque->top) * sizeof(ApplyTask*));
+        deque->bottom -= deque->top;
+        deque->top = 0;
+        if (deque->bottom == deque->capacity) {
+            deque->capacity *= 2;
+            deque->tasks = realloc(deque->tasks, deque->capacity * sizeof(ApplyTask*));
+        }
+    }
+    deque->tasks[deque->bottom++] = task;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+// Takes the task back unless a thief got it first. Tasks pushed after it
+// are joined before it, so it is the newest one if it is still there.
+static bool apply_pop(ApplyPool *pool, int self, const ApplyTask *task) {
+    ApplyDeque *deque = &pool->deques[self];
+    pthread_mutex_lock(&deque->lock);
+    bool found = deque->bottom > deque->top && deque->tasks[deque->bottom - 1] == task;
+    if (found) deque->bottom--;
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static BDDRef bdd_ite_parallel(ApplyPool *pool, int self, BDDRef f, BDDRef g, BDDRef h, int depth) {
+    BDD *bdd = pool->bdd;
+    bool negate;
+    BDDRef result = bdd_ite_standardize(bdd, &f, &g, &h, &negate);
+    if (result != BDD_NONE) return result;
+    if (bdd_aborted(bdd)) return BDD_ZERO;
+
+    uint32_t top = bdd_ite_top(bdd, f, g, h);
+    if (depth >= APPLY_FORK_DEPTH || (uint32_t)bdd->var_count - top < APPLY_MIN_LEVELS) {
+        result = bdd_ite(bdd, f, g, h);
+        return negate ? BDD_NOT(result) : result;
+    }
+
+    result = computed_lookup(&bdd->cache, OP_ITE, f, g, h);
+    if (result == BDD_NONE) {
+        ApplyTask task = {
+            .f = bdd_cofactor(bdd, f, top, true),
+            .g = bdd_cofactor(bdd, g, top, true),
+            .h = bdd_cofactor(bdd, h, top, true),
+            .depth = depth + 1,
+        };
+        apply_push(pool, self, &task);
+        BDDRef low = bdd_ite_parallel(pool, self, bdd_cofactor(bdd, f, top, false), bdd_cofactor(bdd, g, top, false),
+                                      bdd_cofactor(bdd, h, top, false), depth + 1);
+        if (apply_pop(pool, self, &task)) {
+            task.result = bdd_ite_parallel(pool, self, task.f, task.g, task.h, task.depth);
+        } else {
+            // Help with other tasks until the thief is done with this one
+            while (!__atomic_load_n(&task.done, __ATOMIC_ACQUIRE)) {
+                if (!apply_steal(pool, self)) sched_yield();
+            }
+        }
+        result = find_or_create_node(bdd, top, task.result, low);
+        computed_insert(&bdd->cache, OP_ITE, f, g, h, result);
+    }
+    return negate ? BDD_NOT(result) : result;
+}
+
+// Runs the oldest task of some other thread. Returns false if there was none.
+static bool apply_steal(ApplyPool *pool, int self) {
+    for (int k = 1; k < pool->threads; k++) {
+        ApplyDeque *deque = &pool->deques[(self + k) % pool->threads];
+        pthread_mutex_lock(&deque->lock);
+        ApplyTask *task = deque->bottom > deque->top ? deque->tasks[deque->top++] : NULL;
+        pthread_mutex_unlock(&deque->lock);
+        if (!task) continue;
+        task->result = bdd_ite_parallel(pool, self, task->f, task->g, task->h, task->depth);
+        __atomic_store_n(&task->done, 1, __ATOMIC_RELEASE);
+        return true;
+    }
+    return false;
+}
+
+typedef struct
+{
+    ApplyPool *pool;
+    int id;
+} ApplyWorker;
+
+// Sleeps between applies and steals tasks during them
+static void *apply_worker(void *arg) {
+    ApplyWorker *worker = arg;
+    ApplyPool *pool = worker->pool;
+    pthread_mutex_lock(&pool->state_lock);
+    for (;;) {
+        while (!pool->active && !pool->shutdown) pthread_cond_wait(&pool->wake, &pool->state_lock);
+        if (pool->shutdown) break;
+        pool->running++;
+        pthread_mutex_unlock(&pool->state_lock);
+        while (__atomic_load_n(&pool->active, __ATOMIC_ACQUIRE)) {
+            if (!apply_steal(pool, worker->id)) sched_yield();
+        }
+        pthread_mutex_lock(&pool->state_lock);
+        if (--pool->running == 0) pthread_cond_signal(&pool->idle);
+    }
+    pthread_mutex_unlock(&pool->state_lock);
+    free(worker);
+    return NULL;
+}
+
+static ApplyPool *apply_pool_create(BDD *bdd, int threads) {
+    ApplyPool *pool = calloc(1, sizeof(ApplyPool));
+    pool->bdd = bdd;
+    pool->deques = calloc(threads, sizeof(ApplyDeque));
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+        pool->deques[i].capacity = 2 * APPLY_FORK_DEPTH;
+        pool->deques[i].tasks = malloc(pool->deques[i].capacity * sizeof(ApplyTask*));
+    }
+    pthread_mutex_init(&pool->alloc_lock, NULL);
+    pool->cache_locks = calloc(CACHE_LOCK_STRIPES, 1);
+    pthread_mutex_init(&pool->state_lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+
+    // The calling thread is thread 0 and only threads - 1 are spawned
+    pool->workers = malloc(threads * sizeof(pthread_t));
+    pool->threads = 1;
+    for (int i = 1; i < threads; i++) {
+        ApplyWorker *worker = malloc(sizeof(ApplyWorker));
+        *worker = (ApplyWorker){pool, i};
+        if (pthread_create(&pool->workers[pool->threads], NULL, apply_worker, worker) != 0) {
+            free(worker);
+            break;
+        }
+        pool->threads++;
+    }
+    return pool;
+}
+
+static void apply_pool_free(ApplyPool *pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->state_lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->state_lock);
+    for (int i = 1; i < pool->threads; i++) pthread_join(pool->workers[i], NULL);
+
+    for (int i = 0; i < pool->level_lock_count; i++) pthread_mutex_destroy(&pool->level_locks[i]);
+    for (int i = 0; i < pool->threads; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+    pthread_mutex_destroy(&pool->alloc_lock);
+    pthread_mutex_destroy(&pool->state_lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->idle);
+    free(pool->level_locks);
+    free(pool->cache_locks);
+    free(pool->deques);
+    free(pool->workers);
+    free(pool);
+}
+
+// Whether at least `limit` nodes are reachable from f. The walk stops as
+// soon as it has seen that many, so it costs O(limit) at most.
+static bool bdd_reaches(BDD *bdd, BDDRef f, int limit) {
+    bdd_begin_visit(bdd);
+    int top = 0, seen = 0;
+    bdd_work_push(bdd, &top, f);
+    while (top > 0 && seen < limit) {
+        BDDRef ref = bdd->work[--top];
+        if (!bdd_first_visit(bdd, ref)) continue;
+        seen++;
+        BDDNode *node = bdd_node(bdd, ref);
+        bdd_work_push(bdd, &top, node->high);
+        bdd_work_push(bdd, &top, node->low);
+    }
+    return seen >= limit;
+}
+
+// ORs two functions like bdd_or, splitting the work over the pool of a
+// BDD that has one once both operands are large enough to be worth it.
+// Waking the workers costs more than most merges of a balanced build,
+// whose operands are small even when the table is not.
+static BDDRef bdd_or_parallel(BDD *bdd, BDDRef f, BDDRef g) {
+    ApplyPool *pool = bdd->pool;
+    if (!pool || pool->threads < 2 || !bdd_reaches(bdd, f, APPLY_MIN_OPERAND) ||
+        !bdd_reaches(bdd, g, APPLY_MIN_OPERAND)) {
+        return bdd_or(bdd, f, g);
+    }
+
+    // Levels may have been added since the last apply
+    if (pool->level_lock_count < bdd->var_count) {
+        pool->level_locks = realloc(pool->level_locks, bdd->var_count * sizeof(pthread_mutex_t));
+        for (int i = pool->level_lock_count; i < bdd->var_count; i++) pthread_mutex_init(&pool->level_locks[i], NULL);
+        pool->level_lock_count = bdd->var_count;
+    }
+    bdd->arena.shared = true;
+    bdd->cache.locks = pool->cache_locks;
+    bdd->parallel = true;
+    pthread_mutex_lock(&pool->state_lock);
+    __atomic_store_n(&pool->active, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->state_lock);
+
+    BDDRef result = bdd_ite_parallel(pool, 0, f, BDD_ONE, g, 0);
+
+    // Every task has been joined; wait for the workers to stop looking
+    pthread_mutex_lock(&pool->state_lock);
+    __atomic_store_n(&pool->active, 0, __ATOMIC_RELEASE);
+    while (pool->running > 0) pthread_cond_wait(&pool->idle, &pool->state_lock);
+    pthread_mutex_unlock(&pool->state_lock);
+    bdd->parallel = false;
+    bdd->cache.locks = NULL;
+    bdd->arena.shared = false;
+    arena_free_retired(&bdd->arena);
+    return result;
+}
+
+// -------------------- Garbage Collection --------------------
+// A node counts the protections callers hold on it plus its live parents;
+// only live nodes reference their children. Dead nodes are then exactly
+// those no protected root reaches, so dead_nodes is exact and the live
+// count is the table size minus it. Dead nodes stay in the unique table,
+// where they can still be found and revived, until a collection frees
+// them. Partial results that must survive a construction checkpoint are
+// protected while they are in use.
+#define GC_DEAD_FRACTION 0.5
+#define GC_MIN_NODES 4096 // smaller tables are not worth collecting automatically
+#define GC_FLOOR_GROWTH 2 // the next collection waits for this many dead nodes per live one
+
+static void arena_release(BDD *bdd, BDDRef ref) {
+    BDDNode *node = bdd_node(bdd, ref);
+    node->level = BDD_FREE_LEVEL;
+    node->high = bdd->arena.free_list;
+    bdd->arena.free_list = ref >> 1;
+    bdd->arena.in_use--;
+}
+
+// Drops one reference on a live node; a node left without any is unlinked
+// and released at once, which may in turn release its children
+static void bdd_deref_node(BDD *bdd, BDDRef ref) {
+    int top = 0;
+    bdd_work_push(bdd, &top, ref);
+    while (top > 0) {
+        BDDRef next = BDD_REGULAR(bdd->work[--top]);
+        BDDNode *node = bdd_node(bdd, next);
+        if (--node->ref > 0) continue;
+
+        BDDRef high = node->high, low = node->low;
+        unique_remove(bdd, next);
+        arena_release(bdd, next);
+        bdd_work_push(bdd, &top, high);
+        bdd_work_push(bdd, &top, low);
+    }
+}
+
+// Keeps a result and everything below it alive across collections. The
+// root of a BDD returned by BDD_create is already protected.
+void BDD_protect(BDD *bdd, BDDRef ref) {
+    bdd_ref_node(bdd, ref);
+}
+
+void BDD_unprotect(BDD *bdd, BDDRef ref) {
+    bdd_unref_node(bdd, ref);
+}
+
+// Frees every dead node. Dead nodes hold no references, so nothing else
+// changes. Returns the number of nodes freed.
+void BDD_frozen_free(BDDFrozen *frozen);
+
+// Drops the frozen copy kept by BDD_use_batch. Collections, sifting and
+// constructions call it, as each may free or renumber the nodes it copied.
+static void bdd_drop_frozen(BDD *bdd) {
+    BDD_frozen_free(bdd->frozen);
+    bdd->frozen = NULL;
+}
+
+int BDD_collect_garbage(BDD *bdd) {
+    bdd_drop_frozen(bdd);
+    NodeArena *arena = &bdd->arena;
+    uint32_t before = arena->in_use;
+    uint64_t start = BDD_STATS_CLOCK();
+
+    // Every node sits in its level's subtable, so each subtable is swept
+    // once: live entries are kept aside, dead ones released, and the kept
+    // ones rehashed into the emptied buckets. That costs a pass over the
+    // buckets instead of a deletion with backward shifts per dead node.
+    uint32_t largest = 0;
+    for (int level = 0; level < bdd->unique.level_count; level++) {
+        if (bdd->unique.levels[level].size > largest) largest = bdd->unique.levels[level].size;
+    }
+    BDDRef *kept = malloc((largest > 0 ? largest : 1) * sizeof(BDDRef));
+    int live = 0;
+    for (int level = 0; level < bdd->unique.level_count; level++) {
+        UniqueSubtable *sub = &bdd->unique.levels[level];
+        uint32_t count = 0, mask = sub->capacity - 1;
+        for (uint32_t i = 0; i < sub->capacity; i++) {
+            BDDRef ref = sub->buckets[i];
+            if (ref == BDD_NONE) continue;
+            sub->buckets[i] = BDD_NONE;
+            if (bdd_node(bdd, ref)->ref > 0) kept[count++] = ref;
+            else arena_release(bdd, ref);
+        }
+        for (uint32_t k = 0; k < count; k++) {
+            BDDNode *node = bdd_node(bdd, kept[k]);
+            uint32_t slot = unique_hash(node->high, node->low) & mask;
+            while (sub->buckets[slot] != BDD_NONE) slot = (slot + 1) & mask;
+            sub->buckets[slot] = kept[k];
+        }
+        sub->size = count;
+        live += count;
+    }
+    free(kept);
+    bdd->unique.size = live;
+    bdd->dead_nodes = 0;
+
+    // Freed handles may come back as unrelated nodes, so no memoized result
+    // can be trusted; a new cache generation drops them all in O(1)
+    computed_clear(&bdd->cache);
+    BDD_STAT_ADD(bdd, gc_runs, 1);
+    BDD_STAT_ADD(bdd, gc_freed, before - arena->in_use);
+    BDD_STAT_ADD(bdd, phase_ns[BDD_PHASE_GC], BDD_STATS_CLOCK() - start);
+    return (int)(before - arena->in_use);
+}
+
+// Automatic trigger used between construction steps: enough of the table
+// is dead, and at least gc_floor nodes died since the last collection
+static void bdd_maybe_collect(BDD *bdd) {
+    if (bdd->unique.size < GC_MIN_NODES) return;
+    if (bdd->dead_nodes <= bdd->gc_dead_fraction * bdd->unique.size) return;
+    if (bdd->dead_nodes < bdd->gc_floor) return;
+    BDD_collect_garbage(bdd);
+    // Hysteresis: a fold that replaces part of its result on every step
+    // would otherwise cross the fraction again a few steps later. The
+    // floor only grows, so a BDD that shrank does not collect more often.
+    int floor = GC_FLOOR_GROWTH * bdd->unique.size;
+    if (floor > bdd->gc_floor) bdd->gc_floor = floor;
+}
+
+// -------------------- Dynamic Reordering --------------------
+#define SIFT_MAX_GROWTH 1.2 // stop moving a variable once the BDD grows this much
+#define REORDER_MIN_THRESHOLD 4096
+
+// Moves every node of a subtable into `out` and leaves the subtable empty
+static int unique_drain(BDD *bdd, uint32_t level, BDDRef *out) {
+    UniqueSubtable *sub = &bdd->unique.levels[level];
+    int count = 0;
+    for (uint32_t i = 0; i < sub->capacity; i++) {
+        if (sub->buckets[i] != BDD_NONE) out[count++] = sub->buckets[i];
+    }
+    memset(sub->buckets, 0, sub->capacity * sizeof(BDDRef));
+    bdd->unique.size -= sub->size;
+    sub->size = 0;
+    return count;
+}
+
+// Exchanges the variables at `level` and `level + 1` in place. Every node
+// keeps its handle and the function it represents, so references from
+// above stay valid; nodes of the lower variable that lose their last
+// parent are released. The table must hold no dead nodes, as after a
+// collection.
+static void bdd_swap_levels(BDD *bdd, uint32_t level) {
+    uint32_t lower = level + 1;
+    int upper_size = bdd->unique.levels[level].size;
+    int lower_size = bdd->unique.levels[lower].size;
+    BDDRef *xs = malloc((upper_size + 1) * sizeof(BDDRef));
+    BDDRef *ys = malloc((lower_size + 1) * sizeof(BDDRef));
+    upper_size = unique_drain(bdd, level, xs);
+    lower_size = unique_drain(bdd, lower, ys);
+
+    // Split the upper nodes into those that branch on the lower variable
+    // (kept in xs[0..dependent)) and those that can simply move down
+    BDDRef (*cofactors)[4] = malloc((upper_size + 1) * sizeof(*cofactors));
+    int dependent = 0;
+    for (int i = 0; i < upper_size; i++) {
+        BDDNode *node = bdd_node(bdd, xs[i]);
+        BDDRef f1 = node->high, f0 = node->low;
+        if (bdd_level(bdd, f1) != lower && bdd_level(bdd, f0) != lower) {
+            node->level = lower;
+            unique_insert(bdd, lower, xs[i]);
+            continue;
+        }
+        cofactors[dependent][0] = bdd_cofactor(bdd, f1, lower, true);
+        cofactors[dependent][1] = bdd_cofactor(bdd, f1, lower, false);
+        cofactors[dependent][2] = bdd_cofactor(bdd, f0, lower, true);
+        cofactors[dependent][3] = bdd_cofactor(bdd, f0, lower, false);
+        xs[dependent++] = xs[i];
+    }
+
+    // Lower-variable nodes move up unchanged
+    for (int i = 0; i < lower_size; i++) {
+        bdd_node(bdd, ys[i])->level = level;
+        unique_insert(bdd, level, ys[i]);
+    }
+
+    // Rebuild the dependent nodes as y ? (x ? f11 : f01) : (x ? f10 : f00).
+    // Their old children are only released once every new child exists.
+    BDDRef *old_children = malloc((2 * dependent + 1) * sizeof(BDDRef));
+    for (int i = 0; i < dependent; i++) {
+        BDDRef high = find_or_create_node(bdd, lower, cofactors[i][0], cofactors[i][2]);
+        BDDRef low = find_or_create_node(bdd, lower, cofactors[i][1], cofactors[i][3]);
+        bdd_ref_node(bdd, high);
+        bdd_ref_node(bdd, low);
+
+        BDDNode *node = bdd_node(bdd, xs[i]);
+        old_children[2 * i] = node->high;
+        old_children[2 * i + 1] = node->low;
+        node->high = high;
+        node->low = low;
+        unique_insert(bdd, level, xs[i]);
+    }
+    for (int i = 0; i < 2 * dependent; i++) bdd_deref_node(bdd, old_children[i]);
+
+    int x = bdd->var_order[level];
+    bdd->var_order[level] = bdd->var_order[lower];
+    bdd->var_order[lower] = x;
+    bdd->var_level[bdd->var_order[level]] = level;
+    bdd->var_level[x] = lower;
+    BDD_STAT_ADD(bdd, level_swaps, 1);
+
+    free(old_children);
+    free(cofactors);
+    free(ys);
+    free(xs);
+}
+
+// Rudell sifting step: moves one variable through every level, nearer end
+// first, and leaves it where the BDD was smallest
+static void bdd_sift_variable(BDD *bdd, int var) {
+    int last = bdd->var_count - 1;
+    int pos = bdd->var_level[var];
+    int best_pos = pos;
+    int best_size = bdd->unique.size;
+    bool down_first = pos > last / 2;
+
+    for (int pass = 0; pass < 2; pass++) {
+        bool down = (pass == 0) == down_first;
+        int limit = (int)(best_size * SIFT_MAX_GROWTH);
+        while (down ? pos < last : pos > 0) {
+            bdd_swap_levels(bdd, down ? pos : pos - 1);
+            pos += down ? 1 : -1;
+            if (bdd->unique.size < best_size) {
+                best_size = bdd->unique.size;
+                best_pos = pos;
+            }
+            if (bdd->unique.size > limit) break;
+        }
+    }
+
+    // Return to the best position seen
+    for (; pos < best_pos; pos++) bdd_swap_levels(bdd, pos);
+    for (; pos > best_pos; pos--) bdd_swap_levels(bdd, pos - 1);
+}
+
+// Sifts every variable, the most populated levels first. Dead nodes are
+// collected first, so only results that are protected survive.
+static void bdd_sift(BDD *bdd) {
+    BDD_collect_garbage(bdd);
+    uint64_t start = BDD_STATS_CLOCK(); // the collection counts as GC time
+
+    int *vars = malloc((bdd->var_count + 1) * sizeof(int));
+    for (int v = 0; v < bdd->var_count; v++) vars[v] = v;
+    // Insertion sort by population, largest first
+    for (int i = 1; i < bdd->var_count; i++) {
+        int v = vars[i], size = bdd->unique.levels[bdd->var_level[v]].size, j = i - 1;
+        while (j >= 0 && (int)bdd->unique.levels[bdd->var_level[vars[j]]].size < size) {
+            vars[j + 1] = vars[j];
+            j--;
+        }
+        vars[j + 1] = v;
+    }
+    for (int i = 0; i < bdd->var_count; i++) bdd_sift_variable(bdd, vars[i]);
+    free(vars);
+
+    // Reordering never changes what a surviving handle means, but freed
+    // handles may be reused, so memoized results must go
+    computed_clear(&bdd->cache);
+    BDD_STAT_ADD(bdd, sift_runs, 1);
+    BDD_STAT_ADD(bdd, phase_ns[BDD_PHASE_REORDER], BDD_STATS_CLOCK() - start);
+}
+
+// Reorders the variables of a finished BDD in place by sifting. Only nodes
+// reachable from the root or from protected results survive.
+void BDD_reorder(BDD *bdd) {
+    bdd_sift(bdd);
+}
+
+// Automatic trigger used between construction steps: once the table has
+// grown past the threshold, sift with the given partial results as roots
+// and wait for the BDD to double before trying again. Returns true if the
+// order changed.
+static bool bdd_maybe_reorder(BDD *bdd) {
+    if (!bdd->auto_reorder || bdd->unique.size < bdd->next_reorder) return false;
+    // A sift stopped halfway would leave levels inconsistent, so the limits
+    // wait until it is done
+    bool abortable = bdd->abortable;
+    bdd->abortable = false;
+    bdd_sift(bdd);
+    bdd->abortable = abortable;
+    bdd->next_reorder = 2 * bdd->unique.size;
+    if (bdd->next_reorder < bdd->reorder_threshold) bdd->next_reorder = bdd->reorder_threshold;
+    return true;
+}
+
+// Safe point between construction steps: collects and then reorders as
+// configured, and stops the construction if the protected partial results
+// hold more nodes than its limit. Returns true if the order changed.
+static bool bdd_checkpoint(BDD *bdd) {
+    if (bdd_aborted(bdd)) return false;
+    bdd_maybe_collect(bdd);
+    bool reordered = bdd_maybe_reorder(bdd);
+    bdd->checkpoint_size = bdd->unique.size;
+    if (bdd->abortable && bdd->node_limit > 0 && bdd_live_nodes(bdd) > bdd->node_limit) {
+        bdd->aborted = BDD_ABORT_NODES;
+    }
+    return reordered;
+}
+
+// Starts a construction that the node limit and the memory cap may stop
+static void bdd_begin_build(BDD *bdd) {
+    bdd_drop_frozen(bdd);
+    bdd->abortable = true;
+    bdd->checkpoint_size = bdd->unique.size;
+}
+
+// Ends a construction. If a limit stopped it, drops the protected result,
+// frees the nodes built and the results memoized after the stop, sets
+// errno to EFBIG for the node limit or ENOMEM for memory, and returns
+// BDD_NONE.
+static BDDRef bdd_end_build(BDD *bdd, BDDRef result) {
+    bdd->abortable = false;
+    BDDAbort reason = bdd->aborted;
+    if (reason == BDD_ABORT_NONE) return result;
+    bdd_unref_node(bdd, result);
+    BDD_collect_garbage(bdd);
+    computed_clear(&bdd->cache);
+    bdd->aborted = BDD_ABORT_NONE;
+    errno = reason == BDD_ABORT_NODES ? EFBIG : ENOMEM;
+    return BDD_NONE;
+}
+
+// Value of the function at `root` for an input string in BDD_use form
+static char bdd_eval(const BDD *bdd, BDDRef root, const char *inputs) {
+    // Every complemented edge on the path flips the final value
+    bool negate = BDD_IS_COMPLEMENT(root);
+    BDDNode *current = bdd_node(bdd, root);
+    while (current->level != BDD_TERMINAL_LEVEL) {
+        int input_index = bdd->input_slot[bdd->var_order[current->level]];
+        
+        if (inputs[input_index] != '0' && inputs[input_index] != '1') {
+            return -1;
+        }
+        
+        BDDRef next = (inputs[input_index] == '1') ? current->high : current->low;
+        negate ^= BDD_IS_COMPLEMENT(next);
+        current = bdd_node(bdd, next);
+    }
+    
+    return negate ? '0' : '1';
+}
+
+// In BDD_use(), add input validation:
+char BDD_use(BDD *bdd, const char *inputs) {
     if (!bdd || !inputs) return -1;
+    return bdd_eval(bdd, bdd->root, inputs);
+}
+
+// Collects the nodes reachable from the root, ordered by level with the
+// terminal last, and maps each node's arena index to its position
+typedef struct
+{
+    BDDRef *nodes;
+    int count;
+} NodeList;
+
+static void append_node(BDD *bdd, BDDRef node, void *context) {
+    (void)bdd;
+    NodeList *list = context;
+    list->nodes[list->count++] = node;
+}
+
+static int collect_by_level(BDD *bdd, BDDRef **nodes_out, int **position_out) {
+    NodeArena *arena = &bdd->arena;
+    NodeList list = {.nodes = malloc(arena->in_use * sizeof(BDDRef) + sizeof(BDDRef))};
+    int count = bdd_traverse(bdd, &bdd->root, 1, append_node, NULL, &list);
+    BDDRef *nodes = list.nodes;
+
+    // Counting sort by level; the terminal goes into the extra last bucket
+    int *bucket = calloc(bdd->var_count + 2, sizeof(int));
+    for (int i = 0; i < count; i++) {
+        BDDNode *node = bdd_node(bdd, nodes[i]);
+        uint32_t level = node->level == BDD_TERMINAL_LEVEL ? (uint32_t)bdd->var_count : node->level;
+        bucket[level + 1]++;
+    }
+    for (int l = 0; l <= bdd->var_count; l++) bucket[l + 1] += bucket[l];
+
+    BDDRef *sorted = malloc(count * sizeof(BDDRef) + sizeof(BDDRef));
+    int *position = malloc(arena->next * sizeof(int));
+    for (int i = 0; i < count; i++) {
+        BDDNode *node = bdd_node(bdd, nodes[i]);
+        uint32_t level = node->level == BDD_TERMINAL_LEVEL ? (uint32_t)bdd->var_count : node->level;
+        int at = bucket[level]++;
+        sorted[at] = nodes[i];
+        position[nodes[i] >> 1] = at;
+    }
+    free(bucket);
+    free(nodes);
+
+    *nodes_out = sorted;
+    *position_out = position;
+    return count;
+}
+
+// Joins variable names in the syntax BDD_create accepts for var_order
+static char *join_var_names(char *const *names, int count, DNFSyntax syntax) {
+    size_t length = 1;
+    for (int i = 0; i < count; i++) length += strlen(names[i]) + 1;
+
+    char *joined = malloc(length);
+    char *out = joined;
+    for (int i = 0; i < count; i++) {
+        if (syntax == DNF_SYNTAX_NAMES && i > 0) *out++ = ' ';
+        size_t n = strlen(names[i]);
+        memcpy(out, names[i], n);
+        out += n;
+    }
+    *out = '\0';
+    return joined;
+}
+
+// Collects the ids of the variables a var_order string lists, interning
+// names the DNF did not mention
+static int *parse_var_order(VarTable *vars, DNFSyntax syntax, const char *var_order, int *listed) {
+    int capacity = 16, count = 0;
+    int *ids = malloc(capacity * sizeof(int));
+    for (const char *p = var_order; *p;) {
+        if (!is_var_start(syntax, *p)) {
+            p++;
+            continue;
+        }
+        if (count == capacity) {
+            capacity *= 2;
+            ids = realloc(ids, capacity * sizeof(int));
+        }
+        ids[count++] = intern_var_at(vars, syntax, &p);
+    }
+    *listed = count;
+    return ids;
+}
+
+// Lays out the levels: the listed variables take the top levels in the
+// given order, any other variables follow in order of first appearance.
+// Also sizes every per-variable array and the unique table.
+static void bdd_set_order(BDD *bdd, const int *listed_ids, int listed) {
+    bdd->var_count = bdd->vars.count;
+    bdd->var_order = malloc(bdd->var_count * sizeof(int));
+    bdd->var_level = malloc(bdd->var_count * sizeof(int));
+    bdd->input_slot = malloc(bdd->var_count * sizeof(int));
+    for (int v = 0; v < bdd->var_count; v++) bdd->var_level[v] = -1;
+
+    int level = 0;
+    for (int i = 0; i < listed; i++) {
+        if (bdd->var_level[listed_ids[i]] >= 0) continue; // Listed twice
+        bdd->var_level[listed_ids[i]] = level;
+        bdd->var_order[level++] = listed_ids[i];
+    }
+    for (int v = 0; v < bdd->var_count; v++) {
+        if (bdd->var_level[v] >= 0) continue;
+        bdd->var_level[v] = level;
+        bdd->var_order[level++] = v;
+    }
+
+    // Letter-syntax inputs stay indexed by letter ('A' is inputs[0]) so
+    // existing callers keep working; named variables are indexed by id
+    for (int v = 0; v < bdd->var_count; v++) {
+        bdd->input_slot[v] = bdd->syntax == DNF_SYNTAX_LETTERS ? bdd->vars.names[v][0] - 'A' : v;
+    }
+
+    unique_init(&bdd->unique, bdd->var_count);
+}
+
+// ORs protected partial results pairwise, level by level, until one
+// remains; the result inherits their protection
+static BDDRef bdd_or_balanced(BDD *bdd, BDDRef *parts, int count) {
+    if (count == 0) return BDD_ZERO;
+    while (count > 1) {
+        int merged = 0;
+        for (int i = 0; i + 1 < count; i += 2) {
+            BDDRef result = bdd_keep(bdd, parts[i], bdd_or_parallel(bdd, parts[i], parts[i + 1]));
+            bdd_unref_node(bdd, parts[i + 1]);
+            parts[merged++] = result;
+        }
+        if (count % 2) parts[merged++] = parts[count - 1];
+        count = merged;
+        bdd_checkpoint(bdd);
+    }
+    return parts[0];
+}
+
+// Re-sorts the literals of terms not yet inserted after the order changed
+static void resort_terms(const BDD *bdd, DNFTerm *terms, int term_count) {
+    SortContext ctx = {.var_level = bdd->var_level};
+    for (int i = 0; i < term_count; i++) sort_term_vars(terms[i].vars, terms[i].length, &ctx);
+}
+
+// Combines level-sorted terms into one BDD using the selected mode. The
+// result is returned protected.
+static BDDRef bdd_build_terms(BDD *bdd, DNFTerm *terms, int term_count, BDDBuildMode mode) {
+    if (mode == BUILD_SEQUENTIAL) {
+        BDDRef result = BDD_ZERO;
+        for (int i = 0; i < term_count; i++) {
+            if (terms[i].length == 0) continue;
+            uint64_t start = BDD_STATS_CLOCK();
+            result = bdd_keep(bdd, result, bdd_or_cube(bdd, result, terms[i].vars, terms[i].length));
+            BDD_STAT_ADD(bdd, phase_ns[BDD_PHASE_OR], BDD_STATS_CLOCK() - start);
+            if (bdd_checkpoint(bdd)) resort_terms(bdd, terms + i + 1, term_count - i - 1);
+        }
+        return result;
+    }
+
+    BDDRef *parts = malloc((term_count + 1) * sizeof(BDDRef));
+    int part_count = 0;
+
+    if (mode == BUILD_BALANCED) {
+        for (int i = 0; i < term_count; i++) {
+            if (terms[i].length == 0) continue;
+            uint64_t start = BDD_STATS_CLOCK();
+            parts[part_count] = bdd_or_cube(bdd, BDD_ZERO, terms[i].vars, terms[i].length);
+            bdd_ref_node(bdd, parts[part_count++]);
+            BDD_STAT_ADD(bdd, phase_ns[BDD_PHASE_TERMS], BDD_STATS_CLOCK() - start);
+            if (bdd_checkpoint(bdd)) resort_terms(bdd, terms + i + 1, term_count - i - 1);
+        }
+    } else {
+        // Bucket terms by the level of their first literal; each cluster is
+        // folded with the cube kernel, which stays within its subgraph
+        int *cluster_start = calloc(bdd->var_count + 1, sizeof(int));
+        int *ordered = malloc((term_count > 0 ? term_count : 1) * sizeof(int));
+        for (int i = 0; i < term_count; i++) {
+            if (terms[i].length > 0) cluster_start[bdd->var_level[terms[i].vars[0].var] + 1]++;
+        }
+        for (int level = 0; level < bdd->var_count; level++) {
+            cluster_start[level + 1] += cluster_start[level];
+        }
+        int *fill = malloc((bdd->var_count > 0 ? bdd->var_count : 1) * sizeof(int));
+        memcpy(fill, cluster_start, bdd->var_count * sizeof(int));
+        for (int i = 0; i < term_count; i++) {
+            if (terms[i].length > 0) ordered[fill[bdd->var_level[terms[i].vars[0].var]]++] = i;
+        }
+
+        for (int level = 0; level < bdd->var_count; level++) {
+            if (cluster_start[level] == cluster_start[level + 1]) continue;
+            parts[part_count] = BDD_ZERO;
+            for (int k = cluster_start[level]; k < cluster_start[level + 1]; k++) {
+                DNFTerm *term = &terms[ordered[k]];
+                uint64_t start = BDD_STATS_CLOCK();
+                parts[part_count] = bdd_keep(bdd, parts[part_count],
+                                             bdd_or_cube(bdd, parts[part_count], term->vars, term->length));
+                BDD_STAT_ADD(bdd, phase_ns[BDD_PHASE_OR], BDD_STATS_CLOCK() - start);
+                if (bdd_checkpoint(bdd)) resort_terms(bdd, terms, term_count);
+            }
+            part_count++;
+        }
+        free(fill);
+        free(ordered);
+        free(cluster_start);
+    }
+
+    uint64_t start = BDD_STATS_CLOCK();
+    BDDRef result = bdd_or_balanced(bdd, parts, part_count);
+    BDD_STAT_ADD(bdd, phase_ns[BDD_PHASE_OR], BDD_STATS_CLOCK() - start);
+    free(parts);
+    return result;
+}
+
+// Sets up the node storage and tuning fields of a BDD whose variables and
+// order are already in place
+static void bdd_init_storage(BDD *bdd, const BDDCreateOptions *options) {
+    // Initialize counts FIRST
+    bdd->node_count = 1; // The terminal
+    arena_init(&bdd->arena);
+    computed_init(&bdd->cache, options->cache_size > 0 ? options->cache_size : BDD_CACHE_SIZE);
+    bdd->auto_reorder = options->auto_reorder;
+    bdd->reorder_threshold = options->reorder_threshold > 0 ? options->reorder_threshold
+                                                            : REORDER_MIN_THRESHOLD;
+    bdd->next_reorder = bdd->reorder_threshold;
+    bdd->dead_nodes = 0;
+    bdd->gc_dead_fraction = options->gc_dead_fraction > 0 ? options->gc_dead_fraction : GC_DEAD_FRACTION;
+    bdd->gc_floor = 0;
+    bdd->node_limit = options->node_limit;
+    bdd->checkpoint_size = 0;
+    bdd->abortable = false;
+    bdd->aborted = BDD_ABORT_NONE;
+    bdd->build_mode = options->mode;
+    bdd->visit = NULL;
+    bdd->visit_size = 0;
+    bdd->epoch = 0;
+    bdd->work = NULL;
+    bdd->work_capacity = 0;
+    bdd->pool = options->parallel_apply && options->threads > 1 ? apply_pool_create(bdd, options->threads) : NULL;
+    bdd->parallel = false;
+    bdd->frozen = NULL;
+#if BDD_STATS
+    memset(&bdd->stats, 0, sizeof(BDDStats));
+#endif
+}
+
+void BDD_free(BDD *bdd);
+
+// Builds a BDD over a private copy of `vars` from already parsed terms,
+// placing the listed variables on top. The terms themselves are left
+// untouched, so several builds can share them.
+static BDD* bdd_create_from_terms(const VarTable *vars, DNFSyntax syntax, const DNFTerm *terms,
+                                  int term_count, const int *listed_ids, int listed,
+                                  const BDDCreateOptions *options) {
+    BDD *bdd = malloc(sizeof(BDD));
+    bdd->syntax = syntax;
+    var_table_copy(&bdd->vars, vars);
+    bdd_set_order(bdd, listed_ids, listed);
+
+    // Sort a private copy of every term by this BDD's levels
+    int literal_count = 0;
+    for (int i = 0; i < term_count; i++) literal_count += terms[i].length;
+    Variable *literals = malloc((literal_count > 0 ? literal_count : 1) * sizeof(Variable));
+    DNFTerm *sorted = malloc((term_count > 0 ? term_count : 1) * sizeof(DNFTerm));
+    SortContext ctx = {.var_level = bdd->var_level};
+    for (int i = 0, offset = 0; i < term_count; i++) {
+        sorted[i].vars = literals + offset;
+        sorted[i].length = terms[i].length;
+        memcpy(sorted[i].vars, terms[i].vars, terms[i].length * sizeof(Variable));
+        sort_term_vars(sorted[i].vars, sorted[i].length, &ctx);
+        offset += terms[i].length;
+    }
+    
+    bdd_init_storage(bdd, options);
+    
+    bdd_begin_build(bdd);
+    bdd->root = bdd_end_build(bdd, bdd_build_terms(bdd, sorted, term_count, options->mode));
+    bdd->peak_nodes = bdd->arena.peak;
+
+    free(sorted);
+    free(literals);
+    if (bdd->root == BDD_NONE) {
+        int error = errno;
+        BDD_free(bdd);
+        errno = error;
+        return NULL;
+    }
+    return bdd;
+}
+
+static void free_terms(DNFTerm *terms, int term_count) {
+    for (int i = 0; i < term_count; i++) free(terms[i].vars);
+    free(terms);
+}
+
+BDD* BDD_create_ex(const char *dnf, const char *var_order, const BDDCreateOptions *options) {
+    BDDCreateOptions defaults = {0};
+    if (!options) options = &defaults;
+
+    uint64_t start = BDD_STATS_CLOCK();
+    DNFSyntax syntax = dnf_choose_syntax(options->syntax, dnf, strlen(dnf), var_order);
+    if (syntax == DNF_SYNTAX_AUTO) {
+        errno = EINVAL;
+        return NULL;
+    }
+    VarTable vars;
+    var_table_init(&vars);
+
+    // The listed variables take the first ids, as they do when streaming
+    int term_count, listed;
+    int *listed_ids = parse_var_order(&vars, syntax, var_order, &listed);
+    DNFTerm *terms = normalize_dnf(dnf, syntax, &vars, &term_count);
+    term_count = dnf_prune_terms(terms, term_count, vars.count);
+    uint64_t parsed = BDD_STATS_CLOCK() - start;
+
+    BDD *bdd = bdd_create_from_terms(&vars, syntax, terms, term_count, listed_ids, listed, options);
+    if (bdd) BDD_STAT_ADD(bdd, phase_ns[BDD_PHASE_PARSE], parsed);
+
+    free(listed_ids);
+    free_terms(terms, term_count);
+    var_table_free(&vars);
+    return bdd;
+}
+
+BDD* BDD_create(const char *dnf, const char *var_order) {
+    return BDD_create_ex(dnf, var_order, NULL);
+}
+
+// Gives every variable interned since the order was laid out its own
+// level below the existing ones. No existing node tests these variables,
+// so nodes, handles and cached results all stay valid.
+static void bdd_add_new_vars(BDD *bdd) {
+    int count = bdd->vars.count;
+    if (count == bdd->var_count) return;
+    bdd->var_order = realloc(bdd->var_order, count * sizeof(int));
+    bdd->var_level = realloc(bdd->var_level, count * sizeof(int));
+    bdd->input_slot = realloc(bdd->input_slot, count * sizeof(int));
+    for (int v = bdd->var_count; v < count; v++) {
+        bdd->var_level[v] = v;
+        bdd->var_order[v] = v;
+        bdd->input_slot[v] = bdd->syntax == DNF_SYNTAX_LETTERS ? bdd->vars.names[v][0] - 'A' : v;
+        unique_add_level(&bdd->unique);
+    }
+    bdd->var_count = count;
+}
+
+// Construction state while terms arrive from a DNFParser. Sequential mode
+// folds each term into one result. The other modes merge like a binary
+// counter: `parts` holds at most one partial result per power of two of
+// terms, which keeps the merge tree balanced without storing the terms.
+typedef struct
+{
+    BDD *bdd;
+    BDDBuildMode mode;
+    BDDRef result;
+    BDDRef *parts;
+    int *ranks; // log2 of the number of terms merged into each part
+    int part_count;
+    int part_capacity;
+} StreamBuild;
+
+static void stream_add_term(void *context, Variable *literals, int count) {
+    StreamBuild *build = context;
+    BDD *bdd = build->bdd;
+    bdd_add_new_vars(bdd);
+    SortContext ctx = {.var_level = bdd->var_level};
+    sort_term_vars(literals, count, &ctx);
+
+    uint64_t start = BDD_STATS_CLOCK();
+    if (build->mode == BUILD_SEQUENTIAL) {
+        build->result = bdd_keep(bdd, build->result, bdd_or_cube(bdd, build->result, literals, count));
+        BDD_STAT_ADD(bdd, phase_ns[BDD_PHASE_OR], BDD_STATS_CLOCK() - start);
+        bdd_checkpoint(bdd);
+        return;
+    }
+
+    if (build->part_count == build->part_capacity) {
+        build->part_capacity *= 2;
+        build->parts = realloc(build->parts, build->part_capacity * sizeof(BDDRef));
+        build->ranks = realloc(build->ranks, build->part_capacity * sizeof(int));
+    }
+    build->parts[build->part_count] = bdd_or_cube(bdd, BDD_ZERO, literals, count);
+    bdd_ref_node(bdd, build->parts[build->part_count]);
+    build->ranks[build->part_count++] = 0;
+    uint64_t built = BDD_STATS_CLOCK();
+    BDD_STAT_ADD(bdd, phase_ns[BDD_PHASE_TERMS], built - start);
+    while (build->part_count >= 2 &&
+           build->ranks[build->part_count - 1] == build->ranks[build->part_count - 2]) {
+        build->part_count--;
+        BDDRef *left = &build->parts[build->part_count - 1], right = build->parts[build->part_count];
+        *left = bdd_keep(bdd, *left, bdd_or_parallel(bdd, *left, right));
+        bdd_unref_node(bdd, right);
+        build->ranks[build->part_count - 1]++;
+    }
+    BDD_STAT_ADD(bdd, phase_ns[BDD_PHASE_OR], BDD_STATS_CLOCK() - built);
+    bdd_checkpoint(bdd);
+}
+
+// Source of DNF text for the streaming builder; returns the number of bytes
+// placed in `buffer`, 0 at the end of the input
+typedef size_t (*DNFSourceRead)(void *source, char *buffer, size_t size);
+
+static size_t read_file_source(void *source, char *buffer, size_t size) {
+    return fread(buffer, 1, size, source);
+}
+
+static size_t read_fd_source(void *source, char *buffer, size_t size) {
+    ssize_t got;
+    do {
+        got = read(*(int *)source, buffer, size);
+    } while (got < 0 && errno == EINTR);
+    return got > 0 ? (size_t)got : 0;
+}
+
+typedef struct
+{
+    const char *data;
+    size_t size;
+} MemorySource;
+
+static size_t read_memory_source(void *source, char *buffer, size_t size) {
+    MemorySource *memory = source;
+    if (size > memory->size) size = memory->size;
+    memcpy(buffer, memory->data, size);
+    memory->data += size;
+    memory->size -= size;
+    return size;
+}
+
+// Builds a BDD while the DNF is read in DNF_CHUNK_SIZE pieces, so memory
+// is bounded by the BDD plus one chunk rather than by the input. Unless
+// the options name it, the syntax is detected from the first chunk and the
+// order string; a later chunk that would have changed the decision fails
+// the build with EINVAL, so the result never differs from BDD_create_ex
+// on the whole input. Variables missing from var_order take the next level
+// down when first seen, and in name syntax their input positions follow
+// BDD_var_index. The clustered
+// mode needs every term up front and builds like the balanced one here.
+static BDD* bdd_create_streaming(DNFSourceRead read_source, void *source, const char *var_order,
+                                 const BDDCreateOptions *options) {
+    BDDCreateOptions defaults = {0};
+    if (!options) options = &defaults;
+    if (!var_order) var_order = "";
+
+    char *chunk = malloc(DNF_CHUNK_SIZE);
+    size_t size = read_source(source, chunk, DNF_CHUNK_SIZE);
+
+    DNFSyntax syntax = dnf_choose_syntax(options->syntax, chunk, size, var_order);
+    if (syntax == DNF_SYNTAX_AUTO) {
+        free(chunk);
+        errno = EINVAL;
+        return NULL;
+    }
+    BDD *bdd = malloc(sizeof(BDD));
+    bdd->syntax = syntax;
+    var_table_init(&bdd->vars);
+    int listed;
+    int *listed_ids = parse_var_order(&bdd->vars, bdd->syntax, var_order, &listed);
+    bdd_set_order(bdd, listed_ids, listed);
+    free(listed_ids);
+    bdd_init_storage(bdd, options);
+    bdd_begin_build(bdd);
+
+    StreamBuild build = {
+        .bdd = bdd,
+        .mode = options->mode,
+        .result = BDD_ZERO,
+        .part_count = 0,
+        .part_capacity = 64,
+    };
+    build.parts = malloc(build.part_capacity * sizeof(BDDRef));
+    build.ranks = malloc(build.part_capacity * sizeof(int));
+
+    // Parsing is whatever the feed loop spends outside the term handler
+    uint64_t start = BDD_STATS_CLOCK(), building = bdd_phase_total(bdd);
+    DNFParser parser;
+    dnf_parser_init(&parser, bdd->syntax, &bdd->vars, stream_add_term, &build);
+    bool inferred = options->syntax == DNF_SYNTAX_AUTO && bdd->syntax == DNF_SYNTAX_LETTERS;
+    bool contradicted = false;
+    char last = 0;
+    while (size > 0 && !bdd_aborted(bdd)) {
+        // Inferred letters must hold for the rest of the input as well,
+        // including a letter pair split between two chunks
+        char edge[2] = {last, chunk[0]};
+        if (inferred && (dnf_detect_syntax_n(chunk, size) != DNF_SYNTAX_LETTERS ||
+                         dnf_detect_syntax_n(edge, 2) != DNF_SYNTAX_LETTERS)) {
+            contradicted = true;
+            break;
+        }
+        dnf_parser_feed(&parser, chunk, size);
+        last = chunk[size - 1];
+        size = read_source(source, chunk, DNF_CHUNK_SIZE);
+    }
+    dnf_parser_finish(&parser);
+    dnf_parser_free(&parser);
+    bdd_add_new_vars(bdd);
+    BDD_STAT_ADD(bdd, phase_ns[BDD_PHASE_PARSE],
+                 BDD_STATS_CLOCK() - start - (bdd_phase_total(bdd) - building));
+
+    if (build.mode != BUILD_SEQUENTIAL) {
+        start = BDD_STATS_CLOCK();
+        build.result = BDD_ZERO;
+        while (build.part_count > 0) {
+            BDDRef part = build.parts[--build.part_count];
+            build.result = bdd_keep(bdd, build.result, bdd_or_parallel(bdd, part, build.result));
+            bdd_unref_node(bdd, part);
+        }
+        BDD_STAT_ADD(bdd, phase_ns[BDD_PHASE_OR], BDD_STATS_CLOCK() - start);
+    }
+    bdd->root = bdd_end_build(bdd, build.result); // protected while it was built
+    bdd->peak_nodes = bdd->arena.peak;
+
+    free(build.ranks);
+    free(build.parts);
+    free(chunk);
+    if (bdd->root == BDD_NONE || contradicted) {
+        int error = contradicted ? EINVAL : errno;
+        BDD_free(bdd);
+        errno = error;
+        return NULL;
+    }
+    return bdd;
+}
+
+// Streaming counterparts of BDD_create_ex reading from a stdio stream, a
+// file descriptor or a buffer that need not be NUL-terminated
+BDD* BDD_create_from_file(FILE *in, const char *var_order, const BDDCreateOptions *options) {
+    if (!in) return NULL;
+    return bdd_create_streaming(read_file_source, in, var_order, options);
+}
+
+BDD* BDD_create_from_fd(int fd, const char *var_order, const BDDCreateOptions *options) {
+    if (fd < 0) return NULL;
+    return bdd_create_streaming(read_fd_source, &fd, var_order, options);
+}
+
+BDD* BDD_create_from_memory(const char *dnf, size_t size, const char *var_order,
+                            const BDDCreateOptions *options) {
+    if (!dnf) return NULL;
+    MemorySource memory = {.data = dnf, .size = size};
+    return bdd_create_streaming(read_memory_source, &memory, var_order, options);
+}
+
+// Releases a BDD together with every node it owns
+void BDD_free(BDD *bdd) {
+    if (!bdd) return;
+    apply_pool_free(bdd->pool);
+    BDD_frozen_free(bdd->frozen);
+    arena_free(&bdd->arena);
+    unique_free(&bdd->unique);
+    computed_free(&bdd->cache);
+    var_table_free(&bdd->vars);
+    free(bdd->var_order);
+    free(bdd->var_level);
+    free(bdd->input_slot);
+    free(bdd->visit);
+    free(bdd->work);
+    free(bdd);
+}
+
+// Returns the id of the named variable, or -1 if the BDD does not use it.
+// Every constructor numbers the variables listed in var_order first, then
+// the others in order of first appearance in the DNF.
+int BDD_var_index(const BDD *bdd, const char *name) {
+    return var_table_find(&bdd->vars, name, strlen(name));
+}
+
+const char *BDD_var_name(const BDD *bdd, int var) {
+    return bdd->vars.names[var];
+}
+
+// Length an input string for BDD_use must have to cover every variable
+int BDD_input_width(const BDD *bdd) {
+    int width = 0;
+    for (int v = 0; v < bdd->var_count; v++)
+        if (bdd->input_slot[v] + 1 > width) width = bdd->input_slot[v] + 1;
+    return width;
+}
+
+// Formats the current variable order top to bottom in the syntax that
+// BDD_create accepts; the caller frees the string
+char *BDD_order_string(const BDD *bdd) {
+    char **names = malloc((bdd->var_count > 0 ? bdd->var_count : 1) * sizeof(char *));
+    for (int level = 0; level < bdd->var_count; level++)
+        names[level] = bdd->vars.names[bdd->var_order[level]];
+    char *order = join_var_names(names, bdd->var_count, bdd->syntax);
+    free(names);
+    return order;
+}
+
+// -------------------- Frozen Form --------------------
+// Frozen record of nodes[i] from collect_by_level
+static FrozenNode freeze_node(const BDD *bdd, const BDDRef *nodes, const int *position, int i) {
+    FrozenNode out = {.slot = UINT32_MAX};
+    BDDNode *node = bdd_node(bdd, nodes[i]);
+    if (node->level == BDD_TERMINAL_LEVEL) return out;
+    out.slot = bdd->input_slot[bdd->var_order[node->level]];
+    out.edge[1] = (uint32_t)(position[node->high >> 1] - i) << 1;
+    out.edge[0] = (uint32_t)(position[node->low >> 1] - i) << 1 | BDD_IS_COMPLEMENT(node->low);
+    return out;
+}
+
+// Flattens the BDD into a BDDFrozen that no longer depends on it. Only the
+// nodes are copied, so the frozen form reads inputs by position and knows
+// nothing about variable names.
+BDDFrozen* BDD_freeze(BDD *bdd) {
+    if (!bdd) return NULL;
+
+    BDDRef *nodes;
+    int *position;
+    int count = collect_by_level(bdd, &nodes, &position);
+
+    BDDFrozen *frozen = malloc(sizeof(BDDFrozen));
+    frozen->owned = malloc(count * sizeof(FrozenNode));
+    frozen->nodes = frozen->owned;
+    frozen->count = count;
+    frozen->negated = BDD_IS_COMPLEMENT(bdd->root);
+    frozen->input_width = BDD_input_width(bdd);
+
+    for (int i = 0; i < count; i++) frozen->owned[i] = freeze_node(bdd, nodes, position, i);
+
+    free(position);
+    free(nodes);
+    return frozen;
+}
+
+// Same contract as BDD_use. The walk is a forward scan through one array
+// and picks the edge by indexing rather than branching on the input.
+char BDD_frozen_use(const BDDFrozen *frozen, const char *inputs) {
+    if (!frozen || !inputs) return -1;
+
+    const FrozenNode *node = frozen->nodes;
+    const FrozenNode *terminal = frozen->nodes + frozen->count - 1;
+    uint32_t negate = frozen->negated;
+    while (node != terminal) {
+        unsigned bit = (unsigned char)inputs[node->slot] - '0';
+        if (bit > 1) return -1;
+        uint32_t edge = node->edge[bit];
+        negate ^= edge & 1;
+        node += edge >> 1;
+    }
+    return negate ? '0' : '1';
+}
+
+// Writes a C function `int name(const char *inputs)` that evaluates the
+// frozen BDD with straight-line code: one label per node and gotos for
+// edges. It returns 1 or 0 and expects inputs in BDD_use form.
+void BDD_frozen_emit_c(const BDDFrozen *frozen, FILE *out, const char *name) {
+    int terminal = frozen->count - 1;
+    fprintf(out, "int %s(const char *inputs) {\n", name);
+    fprintf(out, "    int negate = %d;\n", frozen->negated ? 1 : 0);
+    for (int i = 0; i < terminal; i++) {
+        const FrozenNode *node = &frozen->nodes[i];
+        int high = i + (int)(node->edge[1] >> 1);
+        int low = i + (int)(node->edge[0] >> 1);
+        if (i > 0) fprintf(out, "n%d:\n", i);
+        fprintf(out, "    if (inputs[%u] == '1') goto n%d;\n", node->slot, high);
+        if (node->edge[0] & 1) fprintf(out, "    negate ^= 1;\n");
+        if (low != i + 1) fprintf(out, "    goto n%d;\n", low);
+    }
+    fprintf(out, "n%d:\n", terminal);
+    fprintf(out, "    return !negate;\n");
+    fprintf(out, "}\n");
+}
+
+void BDD_frozen_free(BDDFrozen *frozen) {
+    if (!frozen) return;
+    free(frozen->owned);
+    free(frozen);
+}
+
+// -------------------- Batch Evaluation --------------------
+// Words of 64 lanes handled together per pass; the inner loops over them
+// are plain enough for the compiler to vectorize
+#if defined(__AVX512F__)
+#define BDD_BATCH_WORDS 8
+#elif defined(__AVX2__)
+#define BDD_BATCH_WORDS 4
+#else
+#define BDD_BATCH_WORDS 1
+#endif
+
+// Number of 64-bit words holding one bit per assignment
+static inline size_t BDD_batch_words(size_t count) {
+    return (count + 63) / 64;
+}
+
+// Evaluates `count` assignments in one walk per block of lanes. Inputs are
+// bit-sliced: bit k % 64 of inputs[slot * words + k / 64] is the value of
+// input position `slot` (as in BDD_use strings) in assignment k, where
+// words = BDD_batch_words(count). Bit k % 64 of results[k / 64] is set when
+// assignment k satisfies the function; unused high bits are cleared.
+//
+// Instead of following one path per assignment, each block pushes lane
+// masks from the root down both edges in node order, so every node is
+// visited at most once per block. A node keeps two masks, for lanes that
+// reached it through an even or odd number of complemented edges, and the
+// terminal's even mask is the answer. A frontier bitmap marks the nodes
+// that received some lane, and since edges point forward, scanning it in
+// index order visits only those. The frozen BDD is only read, so threads
+// may share it. Returns 0, or -1 with errno set to ENOMEM.
+int BDD_frozen_use_batch(const BDDFrozen *frozen, const uint64_t *inputs, size_t count, uint64_t *results) {
+    if (!frozen || !inputs || !results) return -1;
+    size_t words = BDD_batch_words(count);
+    if (words == 0) return 0;
+
+    int terminal = frozen->count - 1;
+    size_t frontier_words = BDD_batch_words(frozen->count);
+    uint64_t (*masks)[2][BDD_BATCH_WORDS] = calloc(frozen->count, sizeof(*masks)); // [node][parity]
+    uint64_t *frontier = calloc(frontier_words, sizeof(uint64_t));
+    if (!masks || !frontier) {
+        free(frontier);
+        free(masks);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (size_t block = 0; block < words; block += BDD_BATCH_WORDS) {
+        int width = words - block < BDD_BATCH_WORDS ? (int)(words - block) : BDD_BATCH_WORDS;
+        for (int w = 0; w < width; w++) {
+            uint64_t lanes = ~0ULL;
+            if (block + w == words - 1 && count % 64) lanes = (1ULL << (count % 64)) - 1;
+            masks[0][frozen->negated][w] = lanes;
+        }
+        if (terminal > 0) frontier[0] = 1; // the terminal is never marked
+
+        for (size_t f = 0; f < frontier_words; f++) {
+            while (frontier[f]) {
+                int i = (int)(f * 64) + __builtin_ctzll(frontier[f]);
+                frontier[f] &= frontier[f] - 1;
+
+                const FrozenNode *node = &frozen->nodes[i];
+                const uint64_t *x = inputs + (size_t)node->slot * words + block;
+                int high = i + (int)(node->edge[1] >> 1), low = i + (int)(node->edge[0] >> 1);
+                int low_negated = node->edge[0] & 1;
+                uint64_t *even = masks[i][0], *odd = masks[i][1];
+                uint64_t *high_even = masks[high][0], *high_odd = masks[high][1];
+                uint64_t *low_even = masks[low][low_negated], *low_odd = masks[low][!low_negated];
+                uint64_t to_high = 0, to_low = 0;
+                for (int w = 0; w < width; w++) {
+                    uint64_t reached = even[w] | odd[w];
+                    high_even[w] |= even[w] & x[w];
+                    high_odd[w] |= odd[w] & x[w];
+                    low_even[w] |= even[w] & ~x[w];
+                    low_odd[w] |= odd[w] & ~x[w];
+                    to_high |= reached & x[w];
+                    to_low |= reached & ~x[w];
+                    even[w] = odd[w] = 0;
+                }
+                if (to_high && high != terminal) frontier[high / 64] |= 1ULL << (high % 64);
+                if (to_low && low != terminal) frontier[low / 64] |= 1ULL << (low % 64);
+            }
+        }
+
+        for (int w = 0; w < width; w++) {
+            results[block + w] = masks[terminal][0][w];
+            masks[terminal][0][w] = masks[terminal][1][w] = 0;
+        }
+    }
+
+    free(frontier);
+    free(masks);
+    return 0;
+}
+
+// BDD_frozen_use_batch on a frozen copy of the BDD. The copy is made on
+// the first call and kept until a collection, sift or construction changes
+// the nodes, so calls must not overlap; threads should share a BDD_freeze
+// result instead.
+int BDD_use_batch(BDD *bdd, const uint64_t *inputs, size_t count, uint64_t *results) {
+    if (!bdd || !inputs || !results) return -1;
+    if (!bdd->frozen) bdd->frozen = BDD_freeze(bdd);
+    return BDD_frozen_use_batch(bdd->frozen, inputs, count, results);
+}
+
+// -------------------- Equivalence Checking --------------------
+#define VERIFY_CHUNK_WORDS 64 // 4096 assignments per unit of work
+#define VERIFY_MAX_WIDTH 62
+
+// Value of assignment bit b across the 64 lanes of a word whose lane l
+// holds assignment base + l
+static const uint64_t lane_pattern[6] = {
+    0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+    0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL,
+};
+
+// A DNF term compiled against the assignment numbering: input position j
+// is bit width - 1 - j of the assignment index. Literals on the low six
+// bits vary inside a word and are folded into a constant lane mask; the
+// rest are fixed for a whole word and checked with one compare.
+typedef struct
+{
+    uint64_t care;  // assignment bits above the low six the term tests
+    uint64_t value; // their required values
+    uint64_t lanes; // lanes of any word where the low-bit literals hold
+} CompiledTerm;
+
+typedef struct
+{
+    const BDDFrozen *frozen;
+    const CompiledTerm *terms;
+    int term_count;
+    int width;
+    uint64_t total; // 2^width assignments
+    uint64_t chunks;
+
+    pthread_mutex_t lock;
+    uint64_t next_chunk;
+    uint64_t first_failure; // lowest failing assignment so far, total if none
+    bool failure_dnf_value;
+} VerifyJob;
+
+static void *verify_worker(void *arg) {
+    VerifyJob *job = arg;
+    size_t words = BDD_batch_words(job->total < 64 * VERIFY_CHUNK_WORDS ? job->total : 64 * VERIFY_CHUNK_WORDS);
+    uint64_t *inputs = malloc((size_t)job->width * words * sizeof(uint64_t) + sizeof(uint64_t));
+    uint64_t *results = malloc(words * sizeof(uint64_t));
+    uint64_t last_lanes = job->total < 64 ? (1ULL << job->total) - 1 : ~0ULL;
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        uint64_t chunk = job->next_chunk++;
+        uint64_t first_failure = job->first_failure;
+        pthread_mutex_unlock(&job->lock);
+        uint64_t base = chunk * 64 * VERIFY_CHUNK_WORDS;
+        // Chunks are handed out in increasing order, so once one starts
+        // past a known failure no later chunk can find a lower one
+        if (chunk >= job->chunks || base >= first_failure) break;
+
+        for (int j = 0; j < job->width; j++) {
+            int bit = job->width - 1 - j;
+            for (size_t w = 0; w < words; w++) {
+                inputs[j * words + w] = bit < 6 ? lane_pattern[bit]
+                                                : ((base + 64 * w) >> bit & 1) ? ~0ULL : 0;
+            }
+        }
+        BDD_frozen_use_batch(job->frozen, inputs, words * 64 < job->total ? words * 64 : job->total, results);
+
+        for (size_t w = 0; w < words; w++) {
+            uint64_t word_base = base + 64 * w;
+            uint64_t expected = 0;
+            for (int t = 0; t < job->term_count; t++) {
+                if ((word_base & job->terms[t].care) == job->terms[t].value) expected |= job->terms[t].lanes;
+            }
+            uint64_t diff = (expected ^ results[w]) & last_lanes;
+            if (!diff) continue;
+
+            uint64_t failure = word_base + __builtin_ctzll(diff);
+            pthread_mutex_lock(&job->lock);
+            if (failure < job->first_failure) {
+                job->first_failure = failure;
+                job->failure_dnf_value = expected >> (failure % 64) & 1;
+            }
+            pthread_mutex_unlock(&job->lock);
+            break;
+        }
+    }
+
+    free(results);
+    free(inputs);
+    return NULL;
+}
+
+// Checks that the BDD computes `dnf` on every assignment of its
+// BDD_input_width() inputs. The DNF is compiled to per-term bitmasks and
+// evaluated 64 assignments per word, against a batched walk of a frozen
+// copy of the BDD. The assignment space is split into chunks shared by
+// `threads` threads (0 uses every online CPU); the lowest failing
+// assignment is reported whatever the scheduling. Returns -1 without
+// checking if the DNF uses variables the BDD does not know or the space
+// has more than 2^VERIFY_MAX_WIDTH assignments.
+int BDD_verify_dnf(BDD *bdd, const char *dnf, int threads, BDDVerifyResult *result) {
+    if (!bdd || !dnf || !result) return -1;
+    int width = BDD_input_width(bdd);
+    if (width > VERIFY_MAX_WIDTH) return -1;
+
+    VarTable vars;
+    var_table_copy(&vars, &bdd->vars);
+    int term_count;
+    DNFTerm *terms = normalize_dnf(dnf, bdd->syntax, &vars, &term_count);
+    bool unknown = vars.count > bdd->var_count;
+    var_table_free(&vars);
+    if (unknown) {
+        free_terms(terms, term_count);
+        return -1;
+    }
+
+    CompiledTerm *compiled = malloc((term_count + 1) * sizeof(CompiledTerm));
+    for (int t = 0; t < term_count; t++) {
+        CompiledTerm *out = &compiled[t];
+        out->care = out->value = 0;
+        out->lanes = ~0ULL;
+        for (int k = 0; k < terms[t].length; k++) {
+            int bit = width - 1 - bdd->input_slot[terms[t].vars[k].var];
+            bool positive = !terms[t].vars[k].negated;
+            if (bit < 6) {
+                out->lanes &= positive ? lane_pattern[bit] : ~lane_pattern[bit];
+            } else {
+                out->care |= 1ULL << bit;
+                if (positive) out->value |= 1ULL << bit;
+            }
+        }
+    }
+    free_terms(terms, term_count);
+
+    VerifyJob job = {
+        .frozen = BDD_freeze(bdd),
+        .terms = compiled,
+        .term_count = term_count,
+        .width = width,
+        .total = 1ULL << width,
+        .next_chunk = 0,
+    };
+    job.chunks = (job.total + 64 * VERIFY_CHUNK_WORDS - 1) / (64 * VERIFY_CHUNK_WORDS);
+    job.first_failure = job.total;
+    pthread_mutex_init(&job.lock, NULL);
+
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    if ((uint64_t)threads > job.chunks) threads = (int)job.chunks;
+
+    // The calling thread works as well, so only threads - 1 are spawned
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    int spawned = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[spawned], NULL, verify_worker, &job) == 0) spawned++;
+    }
+    verify_worker(&job);
+    for (int i = 0; i < spawned; i++) pthread_join(workers[i], NULL);
+    free(workers);
+    pthread_mutex_destroy(&job.lock);
+
+    result->equivalent = job.first_failure == job.total;
+    result->counterexample = NULL;
+    if (result->equivalent) {
+        result->checked = job.total;
+    } else {
+        result->checked = job.first_failure + 1;
+        result->counterexample = malloc(width + 1);
+        for (int j = 0; j < width; j++)
+            result->counterexample[j] = (job.first_failure >> (width - 1 - j) & 1) ? '1' : '0';
+        result->counterexample[width] = '\0';
+        result->expected = job.failure_dnf_value ? '1' : '0';
+        result->actual = job.failure_dnf_value ? '0' : '1';
+    }
+
+    BDD_frozen_free((BDDFrozen *)job.frozen);
+    free(compiled);
+    return 0;
+}
+
+// -------------------- Serialization --------------------
+#define FNV64_OFFSET 0xCBF29CE484222325ULL
+#define FNV64_PRIME 0x100000001B3ULL
+
+static uint64_t fnv64_update(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV64_PRIME;
+    }
+    return hash;
+}
+
+// Sequential writer that checksums everything it writes
+typedef struct
+{
+    FILE *out;
+    uint64_t hash;
+    bool failed;
+} FileWriter;
+
+static void file_write(FileWriter *writer, const void *data, size_t size) {
+    if (writer->failed || size == 0) return;
+    if (fwrite(data, 1, size, writer->out) != size) writer->failed = true;
+    writer->hash = fnv64_update(writer->hash, data, size);
+}
+
+static uint32_t names_section_size(const VarTable *vars) {
+    size_t size = 0;
+    for (int v = 0; v < vars->count; v++) size += strlen(vars->names[v]) + 1;
+    return (uint32_t)((size + 3) & ~(size_t)3);
+}
+
+// Writes the BDD in the format described at BDDFileHeader. Nodes are
+// converted one record at a time as they are written, so no second copy
+// of the node array is built. Returns 0, or -1 if writing failed.
+int BDD_save(BDD *bdd, FILE *out) {
+    if (!bdd || !out) return -1;
+
+    BDDRef *nodes;
+    int *position;
+    int count = collect_by_level(bdd, &nodes, &position);
+
+    BDDFileHeader header = {
+        .magic = {'B', 'D', 'D', 'F'},
+        .version = BDD_FILE_VERSION,
+        .flags = (BDD_IS_COMPLEMENT(bdd->root) ? BDD_FILE_NEGATED : 0) |
+                 (bdd->syntax == DNF_SYNTAX_NAMES ? BDD_FILE_NAMES : 0),
+        .var_count = (uint32_t)bdd->var_count,
+        .node_count = (uint32_t)count,
+        .input_width = (uint32_t)BDD_input_width(bdd),
+        .names_size = names_section_size(&bdd->vars),
+    };
+    FileWriter writer = {.out = out, .hash = FNV64_OFFSET};
+    file_write(&writer, &header, sizeof(header));
+
+    for (int level = 0; level < bdd->var_count; level++) {
+        uint32_t id = (uint32_t)bdd->var_order[level];
+        file_write(&writer, &id, sizeof(id));
+    }
+    uint32_t names_written = 0;
+    for (int v = 0; v < bdd->var_count; v++) {
+        size_t length = strlen(bdd->vars.names[v]) + 1;
+        file_write(&writer, bdd->vars.names[v], length);
+        names_written += length;
+    }
+    static const char padding[4];
+    file_write(&writer, padding, header.names_size - names_written);
+
+    for (int i = 0; i < count; i++) {
+        FrozenNode record = freeze_node(bdd, nodes, position, i);
+        file_write(&writer, &record, sizeof(record));
+    }
+    uint64_t checksum = writer.hash;
+    file_write(&writer, &checksum, sizeof(checksum));
+
+    free(position);
+    free(nodes);
+    return writer.failed || fflush(out) != 0 ? -1 : 0;
+}
+
+// Checks that every edge of a node array points forward inside it and
+// every input position is in range, so evaluating it cannot run astray
+static bool frozen_nodes_valid(const FrozenNode *nodes, uint32_t count, uint32_t input_width) {
+    if (count == 0 || nodes[count - 1].slot != UINT32_MAX) return false;
+    for (uint32_t i = 0; i + 1 < count; i++) {
+        if (nodes[i].slot >= input_width) return false;
+        for (int e = 0; e < 2; e++) {
+            uint32_t offset = nodes[i].edge[e] >> 1;
+            if (offset == 0 || offset >= count - i) return false;
+        }
+        if (nodes[i].edge[1] & 1) return false; // high edges are never complemented
+    }
+    return true;
+}
+
+static bool file_header_valid(const BDDFileHeader *header) {
+    return memcmp(header->magic, "BDDF", 4) == 0 && header->version == BDD_FILE_VERSION &&
+           header->names_size % 4 == 0 && header->node_count > 0;
+}
+
+// Points `frozen` at the nodes of a BDD_save image held in memory, usually
+// a read-only mmap of the file, after checking its checksum and structure.
+// Nothing is copied or allocated: the image must outlive `frozen`, which
+// must not be passed to BDD_frozen_free. Returns 0, or -1 if the image is
+// malformed.
+int BDD_frozen_map(BDDFrozen *frozen, const void *image, size_t size) {
+    if (!frozen || !image || size < sizeof(BDDFileHeader) + sizeof(uint64_t)) return -1;
+    if ((uintptr_t)image % 4) return -1;
+
+    const BDDFileHeader *header = image;
+    if (!file_header_valid(header)) return -1;
+    uint64_t nodes_at = sizeof(BDDFileHeader) + 4ULL * header->var_count + header->names_size;
+    uint64_t checksum_at = nodes_at + (uint64_t)header->node_count * sizeof(FrozenNode);
+    if (checksum_at + sizeof(uint64_t) != size) return -1;
+
+    uint64_t checksum;
+    memcpy(&checksum, (const char *)image + checksum_at, sizeof(checksum));
+    if (fnv64_update(FNV64_OFFSET, image, checksum_at) != checksum) return -1;
+
+    const FrozenNode *nodes = (const FrozenNode *)((const char *)image + nodes_at);
+    if (!frozen_nodes_valid(nodes, header->node_count, header->input_width)) return -1;
+
+    frozen->nodes = nodes;
+    frozen->owned = NULL;
+    frozen->count = (int)header->node_count;
+    frozen->negated = header->flags & BDD_FILE_NEGATED;
+    frozen->input_width = (int)header->input_width;
+    return 0;
+}
+
+// Sequential reader that checksums everything it reads
+typedef struct
+{
+    FILE *in;
+    uint64_t hash;
+    bool failed;
+} FileReader;
+
+static void file_read(FileReader *reader, void *data, size_t size) {
+    if (reader->failed || size == 0) return;
+    if (fread(data, 1, size, reader->in) != size) {
+        reader->failed = true;
+        return;
+    }
+    reader->hash = fnv64_update(reader->hash, data, size);
+}
+
+// Reads `size` bytes into a new buffer with one spare byte at the end. The
+// buffer grows as data actually arrives, so a corrupt header cannot make
+// the reader allocate much more than the file holds.
+static void *file_read_section(FileReader *reader, uint64_t size) {
+    size_t capacity = 4096, done = 0;
+    char *buffer = malloc(capacity + 1);
+    while (!reader->failed && done < size) {
+        if (done == capacity) {
+            capacity *= 2;
+            buffer = realloc(buffer, capacity + 1);
+        }
+        size_t chunk = capacity - done < size - done ? capacity - done : (size_t)(size - done);
+        file_read(reader, buffer + done, chunk);
+        done += chunk;
+    }
+    return buffer;
+}
+
+// A saved name must read back as the one variable it was written for: a
+// single capital in letter syntax, whose input position it decides, and an
+// identifier in name syntax
+static bool file_name_valid(DNFSyntax syntax, const char *name, size_t length) {
+    if (syntax == DNF_SYNTAX_LETTERS) return length == 1 && name[0] >= 'A' && name[0] <= 'Z';
+    if (length == 0 || !is_var_start(syntax, name[0])) return false;
+    for (size_t i = 1; i < length; i++) {
+        if (!isalnum((unsigned char)name[i]) && name[i] != '_') return false;
+    }
+    return true;
+}
+
+// Builds a BDD from the checked sections of a saved file; returns NULL if
+// they are inconsistent
+static BDD* bdd_from_file_sections(const BDDFileHeader *header, const uint32_t *order,
+                                   const char *names, const FrozenNode *nodes) {
+    uint32_t var_count = header->var_count, node_count = header->node_count;
+    BDD *bdd = malloc(sizeof(BDD));
+    bdd->syntax = header->flags & BDD_FILE_NAMES ? DNF_SYNTAX_NAMES : DNF_SYNTAX_LETTERS;
+    var_table_init(&bdd->vars);
+    const char *name = names;
+    bool valid = true;
+    for (uint32_t v = 0; v < var_count && name < names + header->names_size && valid; v++) {
+        size_t length = strlen(name);
+        valid = file_name_valid(bdd->syntax, name, length);
+        if (valid) var_table_intern(&bdd->vars, name, (int)length);
+        name += length + 1;
+    }
+
+    // Every name and every level exactly once
+    valid = valid && bdd->vars.count == (int)var_count;
+    int *listed = malloc(var_count * sizeof(int) + 1);
+    bool *placed = calloc(var_count + 1, sizeof(bool));
+    for (uint32_t level = 0; level < var_count && valid; level++) {
+        valid = order[level] < var_count && !placed[order[level]];
+        if (valid) placed[order[level]] = true;
+        listed[level] = (int)order[level];
+    }
+    free(placed);
+    if (!valid) {
+        free(listed);
+        var_table_free(&bdd->vars);
+        free(bdd);
+        return NULL;
+    }
+    bdd_set_order(bdd, listed, (int)var_count);
+    free(listed);
+    BDDCreateOptions defaults = {0};
+    bdd_init_storage(bdd, &defaults);
+
+    // Map input positions back to levels, then rebuild bottom-up; the
+    // unique table restores sharing and canonical form
+    int width = BDD_input_width(bdd);
+    valid = (int)header->input_width == width;
+    int *slot_level = malloc((width > 0 ? width : 1) * sizeof(int));
+    for (int i = 0; i < width; i++) slot_level[i] = -1;
+    for (int v = 0; v < bdd->var_count && valid; v++) {
+        int slot = bdd->input_slot[v];
+        valid = slot >= 0 && slot < width && slot_level[slot] < 0;
+        if (valid) slot_level[slot] = bdd->var_level[v];
+    }
+
+    BDDRef *refs = malloc(node_count * sizeof(BDDRef));
+    refs[node_count - 1] = BDD_ONE;
+    for (int i = (int)node_count - 2; i >= 0 && valid; i--) {
+        int level = slot_level[nodes[i].slot];
+        BDDRef high = refs[i + (nodes[i].edge[1] >> 1)];
+        BDDRef low = refs[i + (nodes[i].edge[0] >> 1)] ^ (nodes[i].edge[0] & 1);
+        valid = level >= 0 && bdd_level(bdd, high) > (uint32_t)level && bdd_level(bdd, low) > (uint32_t)level;
+        if (valid) refs[i] = find_or_create_node(bdd, (uint32_t)level, high, low);
+    }
+    BDDRef root = refs[0] ^ (header->flags & BDD_FILE_NEGATED ? 1 : 0);
+    free(refs);
+    free(slot_level);
+    if (!valid) {
+        BDD_free(bdd);
+        return NULL;
+    }
+
+    bdd->root = root;
+    BDD_protect(bdd, bdd->root);
+    BDD_collect_garbage(bdd); // records the root does not reach
+    update_node_count(bdd);
+    bdd->peak_nodes = bdd->arena.peak;
+    return bdd;
+}
+
+// Reads a file written by BDD_save back into a full BDD with the saved
+// variable order, ready for further operations. Returns NULL if the file
+// is malformed or its checksum does not match.
+BDD* BDD_load(FILE *in) {
+    if (!in) return NULL;
+
+    FileReader reader = {.in = in, .hash = FNV64_OFFSET};
+    BDDFileHeader header;
+    file_read(&reader, &header, sizeof(header));
+    if (reader.failed || !file_header_valid(&header)) return NULL;
+
+    uint32_t *order = file_read_section(&reader, header.var_count * (uint64_t)sizeof(uint32_t));
+    char *names = file_read_section(&reader, header.names_size);
+    FrozenNode *nodes = file_read_section(&reader, header.node_count * (uint64_t)sizeof(FrozenNode));
+    if (!reader.failed) names[header.names_size] = '\0';
+    uint64_t expected = reader.hash, checksum = 0;
+    file_read(&reader, &checksum, sizeof(checksum));
+
+    BDD *bdd = NULL;
+    if (!reader.failed && checksum == expected &&
+        frozen_nodes_valid(nodes, header.node_count, header.input_width)) {
+        bdd = bdd_from_file_sections(&header, order, names, nodes);
+    }
+
+    free(nodes);
+    free(names);
+    free(order);
+    return bdd;
+}
+
+// -------------------- Model Counting --------------------
+// Fraction of all assignments on which each node's function is true, and
+// the fraction on which it is false, indexed by arena index. Both are kept
+// so that complemented edges swap them rather than computing 1 - p, which
+// would lose small counts to rounding.
+typedef struct
+{
+    double *ones;
+    double *zeros;
+} SatFractions;
+
+// Post-order visitor: both children are done when a node is reached
+static void sat_fraction_node(BDD *bdd, BDDRef ref, void *context) {
+    SatFractions *memo = context;
+    BDDNode *node = bdd_node(bdd, ref);
+    if (node->level == BDD_TERMINAL_LEVEL) {
+        memo->ones[ref >> 1] = 1;
+        memo->zeros[ref >> 1] = 0;
+        return;
+    }
+    uint32_t high = node->high >> 1, low = node->low >> 1;
+    bool flip = BDD_IS_COMPLEMENT(node->low);
+    double low_ones = flip ? memo->zeros[low] : memo->ones[low];
+    double low_zeros = flip ? memo->ones[low] : memo->zeros[low];
+    memo->ones[ref >> 1] = (memo->ones[high] + low_ones) / 2;
+    memo->zeros[ref >> 1] = (memo->zeros[high] + low_zeros) / 2;
+}
+
+static SatFractions sat_fractions(BDD *bdd) {
+    SatFractions memo = {
+        .ones = malloc(bdd->arena.next * sizeof(double)),
+        .zeros = malloc(bdd->arena.next * sizeof(double)),
+    };
+    bdd_traverse(bdd, &bdd->root, 1, NULL, sat_fraction_node, &memo);
+    return memo;
+}
+
+static inline double sat_fraction(const SatFractions *memo, BDDRef f) {
+    return BDD_IS_COMPLEMENT(f) ? memo->zeros[f >> 1] : memo->ones[f >> 1];
+}
+
+// Number of assignments to the BDD's variables that satisfy it, in linear
+// time. Exact up to 2^53; beyond that a double keeps the magnitude.
+double BDD_sat_count(BDD *bdd) {
+    if (!bdd) return 0;
+    SatFractions memo = sat_fractions(bdd);
+    double count = sat_fraction(&memo, bdd->root);
+    for (int v = 0; v < bdd->var_count; v++) count *= 2;
+    free(memo.zeros);
+    free(memo.ones);
+    return count;
+}
+
+// Writes one satisfying assignment in BDD_use form (BDD_input_width chars
+// plus a terminator) into `out`; inputs the path does not fix are '0'.
+// Returns -1 if the function is unsatisfiable. A canonical BDD is
+// unsatisfiable only when it is the '0' edge itself, so no memo is needed.
+int BDD_any_sat(BDD *bdd, char *out) {
+    if (!bdd || !out || bdd->root == BDD_ZERO) return -1;
+    int width = BDD_input_width(bdd);
+    memset(out, '0', width);
+    out[width] = '\0';
+
+    BDDRef f = bdd->root;
+    while (!BDD_IS_TERMINAL(f)) {
+        BDDNode *node = bdd_node(bdd, f);
+        int slot = bdd->input_slot[bdd->var_order[node->level]];
+        BDDRef high = BDD_IS_COMPLEMENT(f) ? BDD_NOT(node->high) : node->high;
+        BDDRef low = BDD_IS_COMPLEMENT(f) ? BDD_NOT(node->low) : node->low;
+        out[slot] = high != BDD_ZERO ? '1' : '0';
+        f = high != BDD_ZERO ? high : low;
+    }
+    return 0;
+}
+
+// Uniform double in [0, 1) with 53 random bits: the low 27 bits of one
+// rand_r result and the low 26 of the next, side by side. Every bit of the
+// mantissa comes from exactly one draw.
+_Static_assert(RAND_MAX >= (1 << 27) - 1, "random_unit takes 27 bits from one rand_r result");
+static double random_unit(unsigned int *seed) {
+    uint64_t high = (uint64_t)rand_r(seed) & ((1ULL << 27) - 1);
+    uint64_t low = (uint64_t)rand_r(seed) & ((1ULL << 26) - 1);
+    return (double)(high << 26 | low) / (double)(1ULL << 53);
+}
+
+// Draws `samples` satisfying assignments uniformly at random and writes
+// them back to back into `out`, each in BDD_use form with its terminator.
+// The per-node fractions are computed once per call and every sample then
+// costs one root-to-terminal walk: each branch is taken in proportion to
+// the solutions below it and variables the path skips are fair coin flips.
+// Returns -1 if the function is unsatisfiable.
+int BDD_sample_sat(BDD *bdd, unsigned int *seed, char *out, int samples) {
+    if (!bdd || !seed || !out || bdd->root == BDD_ZERO) return -1;
+    int width = BDD_input_width(bdd);
+    SatFractions memo = sat_fractions(bdd);
+
+    for (int n = 0; n < samples; n++) {
+        char *sample = out + (size_t)n * (width + 1);
+        memset(sample, '0', width);
+        sample[width] = '\0';
+        for (int v = 0; v < bdd->var_count; v++) sample[bdd->input_slot[v]] = rand_r(seed) & 1 ? '1' : '0';
+
+        BDDRef f = bdd->root;
+        while (!BDD_IS_TERMINAL(f)) {
+            BDDNode *node = bdd_node(bdd, f);
+            BDDRef high = BDD_IS_COMPLEMENT(f) ? BDD_NOT(node->high) : node->high;
+            BDDRef low = BDD_IS_COMPLEMENT(f) ? BDD_NOT(node->low) : node->low;
+            double p_high = sat_fraction(&memo, high), p_low = sat_fraction(&memo, low);
+            bool take_high = random_unit(seed) * (p_high + p_low) < p_high;
+            sample[bdd->input_slot[bdd->var_order[node->level]]] = take_high ? '1' : '0';
+            f = take_high ? high : low;
+        }
+    }
+
+    free(memo.zeros);
+    free(memo.ones);
+    return 0;
+}
+
+// Starts a depth-first walk over the paths to '1'. Each cube covers the
+// assignments that match its '1'/'0' positions, with '-' for inputs the
+// path does not test; distinct cubes never overlap, so their sizes sum to
+// the satisfying count. The BDD must not change while the iterator is in
+// use.
+BDDCubeIterator *BDD_cubes_begin(BDD *bdd) {
+    if (!bdd) return NULL;
+    int width = BDD_input_width(bdd);
+    BDDCubeIterator *it = malloc(sizeof(BDDCubeIterator));
+    it->bdd = bdd;
+    it->stack = malloc((bdd->var_count + 1) * sizeof(BDDRef));
+    it->state = malloc((bdd->var_count + 1) * sizeof(int));
+    it->cube = malloc(width + 1);
+    memset(it->cube, '-', width);
+    it->cube[width] = '\0';
+    it->depth = 0;
+    if (bdd->root != BDD_ZERO) {
+        it->stack[0] = bdd->root;
+        it->state[0] = 0;
+        it->depth = 1;
+    }
+    return it;
+}
+
+// Copies the next cube into `cube` (BDD_input_width chars plus a
+// terminator) and returns true, or returns false when none are left. Edges
+// to '0' are never followed and every other edge reaches '1', so each call
+// does work proportional to the depth only.
+bool BDD_cubes_next(BDDCubeIterator *it, char *cube) {
+    BDD *bdd = it->bdd;
+    while (it->depth > 0) {
+        int top = it->depth - 1;
+        BDDRef f = it->stack[top];
+        if (BDD_IS_TERMINAL(f)) {
+            it->depth--;
+            strcpy(cube, it->cube);
+            return true;
+        }
+
+        BDDNode *node = bdd_node(bdd, f);
+        int slot = bdd->input_slot[bdd->var_order[node->level]];
+        if (it->state[top] == 2) {
+            it->cube[slot] = '-';
+            it->depth--;
+            continue;
+        }
+        bool high = it->state[top]++ == 0;
+        BDDRef child = high ? node->high : node->low;
+        if (BDD_IS_COMPLEMENT(f)) child = BDD_NOT(child);
+        it->cube[slot] = high ? '1' : '0';
+        if (child == BDD_ZERO) continue;
+        it->stack[it->depth] = child;
+        it->state[it->depth] = 0;
+        it->depth++;
+    }
+    return false;
+}
+
+void BDD_cubes_end(BDDCubeIterator *it) {
+    if (!it) return;
+    free(it->cube);
+    free(it->state);
+    free(it->stack);
+    free(it);
+}
+
+// -------------------- Restriction and Quantification --------------------
+// Both operations take a cube naming the levels they act on: a chain of
+// nodes, one per level, whose non-'0' branch leads to the rest. For
+// restriction that branch is the value the variable is fixed to; for
+// quantification it is always the high branch. The cube is the cache key,
+// so repeated calls with the same assignment reuse earlier results.
+
+// Whether the cube's top variable is fixed to '1'. A '0' literal has a
+// '0' high edge, which canonical form stores as a complemented cube edge.
+static inline bool cube_positive(const BDD *bdd, BDDRef cube) {
+    return bdd_cofactor(bdd, cube, bdd_level(bdd, cube), true) != BDD_ZERO;
+}
+
+// Steps past the cube's top level
+static inline BDDRef cube_rest(const BDD *bdd, BDDRef cube) {
+    return bdd_cofactor(bdd, cube, bdd_level(bdd, cube), cube_positive(bdd, cube));
+}
+
+// Drops the cube levels above `level`, which f cannot depend on
+static inline BDDRef cube_skip_to(const BDD *bdd, BDDRef cube, uint32_t level) {
+    while (cube != BDD_ONE && bdd_level(bdd, cube) < level) cube = cube_rest(bdd, cube);
+    return cube;
+}
+
+// f with every variable of the cube replaced by its fixed value
+static BDDRef bdd_restrict(BDD *bdd, BDDRef f, BDDRef cube) {
+    if (BDD_IS_TERMINAL(f)) return f;
+    bool negate = BDD_IS_COMPLEMENT(f);
+    f = BDD_REGULAR(f);
+    uint32_t level = bdd_level(bdd, f);
+    cube = cube_skip_to(bdd, cube, level);
+    if (cube == BDD_ONE) return negate ? BDD_NOT(f) : f;
+
+    // f is regular, so the complemented result serves !f as well
+    BDDRef result = computed_lookup(&bdd->cache, OP_RESTRICT, f, cube, BDD_NONE);
+    if (result == BDD_NONE) {
+        BDD_STAT_ENTER(bdd);
+        BDDNode *node = bdd_node(bdd, f);
+        if (bdd_level(bdd, cube) == level) {
+            BDDRef child = cube_positive(bdd, cube) ? node->high : node->low;
+            result = bdd_restrict(bdd, child, cube_rest(bdd, cube));
+        } else {
+            result = find_or_create_node(bdd, level, bdd_restrict(bdd, node->high, cube),
+                                         bdd_restrict(bdd, node->low, cube));
+        }
+        computed_insert(&bdd->cache, OP_RESTRICT, f, cube, BDD_NONE, result);
+        BDD_STAT_LEAVE(bdd);
+    }
+    return negate ? BDD_NOT(result) : result;
+}
+
+// Existential quantification of f over the variables of the cube
+static BDDRef bdd_exists(BDD *bdd, BDDRef f, BDDRef cube) {
+    if (BDD_IS_TERMINAL(f)) return f;
+    uint32_t level = bdd_level(bdd, f);
+    cube = cube_skip_to(bdd, cube, level);
+    if (cube == BDD_ONE) return f;
+
+    BDDRef result = computed_lookup(&bdd->cache, OP_EXISTS, f, cube, BDD_NONE);
+    if (result != BDD_NONE) return result;
+
+    BDD_STAT_ENTER(bdd);
+    BDDRef high = bdd_cofactor(bdd, f, level, true);
+    BDDRef low = bdd_cofactor(bdd, f, level, false);
+    if (bdd_level(bdd, cube) == level) {
+        BDDRef rest = cube_rest(bdd, cube);
+        result = bdd_exists(bdd, high, rest);
+        if (result != BDD_ONE) result = bdd_or(bdd, result, bdd_exists(bdd, low, rest));
+    } else {
+        result = find_or_create_node(bdd, level, bdd_exists(bdd, high, cube), bdd_exists(bdd, low, cube));
+    }
+    computed_insert(&bdd->cache, OP_EXISTS, f, cube, BDD_NONE, result);
+    BDD_STAT_LEAVE(bdd);
+    return result;
+}
+
+// Universal quantification, by duality with bdd_exists
+static BDDRef bdd_forall(BDD *bdd, BDDRef f, BDDRef cube) {
+    return BDD_NOT(bdd_exists(bdd, BDD_NOT(f), cube));
+}
+
+// Cube of the variables an assignment in BDD_use form fixes to '0' or '1';
+// any other character leaves the variable free
+static BDDRef assignment_cube(BDD *bdd, const char *assignment) {
+    size_t length = strlen(assignment);
+    BDDRef cube = BDD_ONE;
+    for (int level = bdd->var_count - 1; level >= 0; level--) {
+        size_t slot = bdd->input_slot[bdd->var_order[level]];
+        if (slot >= length) continue;
+        if (assignment[slot] == '1') cube = find_or_create_node(bdd, level, cube, BDD_ZERO);
+        else if (assignment[slot] == '0') cube = find_or_create_node(bdd, level, BDD_ZERO, cube);
+    }
+    return cube;
+}
+
+// Cube of the variables a list in var_order syntax names; names the BDD
+// does not use are skipped, as no function here depends on them
+static BDDRef vars_cube(BDD *bdd, const char *names) {
+    bool *listed = calloc(bdd->var_count + 1, sizeof(bool));
+    for (const char *p = names; *p;) {
+        if (!is_var_start(bdd->syntax, *p)) {
+            p++;
+            continue;
+        }
+        int var = find_var_at(&bdd->vars, bdd->syntax, &p);
+        if (var >= 0) listed[bdd->var_level[var]] = true;
+    }
+
+    BDDRef cube = BDD_ONE;
+    for (int level = bdd->var_count - 1; level >= 0; level--) {
+        if (listed[level]) cube = find_or_create_node(bdd, level, cube, BDD_ZERO);
+    }
+    free(listed);
+    return cube;
+}
+
+// Copies of the nodes of one BDD in another, indexed by arena index
+typedef struct
+{
+    BDD *dst;
+    BDDRef *copied; // regular handle in dst
+} NodeCopy;
+
+static inline BDDRef copied_edge(const NodeCopy *copy, BDDRef f) {
+    return copy->copied[f >> 1] ^ BDD_IS_COMPLEMENT(f);
+}
+
+// Post-order visitor: both children are copied when a node is reached
+static void copy_node(BDD *src, BDDRef ref, void *context) {
+    NodeCopy *copy = context;
+    BDDNode *node = bdd_node(src, ref);
+    if (node->level == BDD_TERMINAL_LEVEL) {
+        copy->copied[ref >> 1] = ref;
+        return;
+    }
+    copy->copied[ref >> 1] = find_or_create_node(copy->dst, node->level, copied_edge(copy, node->high),
+                                                 copied_edge(copy, node->low));
+}
+
+// Moves the function f of `src` into a BDD of its own with the same
+// variables, order and input positions, so it evaluates the same input
+// strings. The intermediate results left dead in `src` are collected once
+// there are enough of them.
+static BDD* bdd_extract(BDD *src, BDDRef f) {
+    BDD *bdd = malloc(sizeof(BDD));
+    bdd->syntax = src->syntax;
+    var_table_copy(&bdd->vars, &src->vars);
+    bdd_set_order(bdd, src->var_order, src->var_count);
+    BDDCreateOptions options = {
+        .cache_size = src->cache.size,
+        .auto_reorder = src->auto_reorder,
+        .reorder_threshold = src->reorder_threshold,
+        .gc_dead_fraction = src->gc_dead_fraction,
+    };
+    bdd_init_storage(bdd, &options);
+
+    NodeCopy copy = {.dst = bdd, .copied = malloc(src->arena.next * sizeof(BDDRef))};
+    bdd_traverse(src, &f, 1, NULL, copy_node, &copy);
+    bdd->root = copied_edge(&copy, f);
+    free(copy.copied);
+    BDD_protect(bdd, bdd->root);
+    update_node_count(bdd);
+    bdd->peak_nodes = bdd->arena.peak;
+
+    bdd_maybe_collect(src);
+    return bdd;
+}
+
+// Specializes the BDD for a partial assignment in BDD_use form: inputs set
+// to '0' or '1' are fixed and any other character ('-') leaves the input
+// free. The result is a new BDD over the remaining inputs that reads the
+// same input strings, so a caller whose tenant or region stays fixed can
+// evaluate the smaller residual per request. The original is unchanged.
+BDD* BDD_restrict(BDD *bdd, const char *assignment) {
+    if (!bdd || !assignment) return NULL;
+    BDDRef cube = assignment_cube(bdd, assignment);
+    return bdd_extract(bdd, bdd_restrict(bdd, bdd->root, cube));
+}
+
+// New BDD that is true where some value of the listed variables satisfies
+// the original. Variables are listed as in a var_order string.
+BDD* BDD_exists(BDD *bdd, const char *vars) {
+    if (!bdd || !vars) return NULL;
+    BDDRef cube = vars_cube(bdd, vars);
+    return bdd_extract(bdd, bdd_exists(bdd, bdd->root, cube));
+}
+
+// New BDD that is true where every value of the listed variables satisfies
+// the original
+BDD* BDD_forall(BDD *bdd, const char *vars) {
+    if (!bdd || !vars) return NULL;
+    BDDRef cube = vars_cube(bdd, vars);
+    return bdd_extract(bdd, bdd_forall(bdd, bdd->root, cube));
+}
+
+// -------------------- Shared Manager --------------------
+
+// Creates an empty manager for functions added with BDD_manager_add. The
+// listed variables take the top levels; any other variable gets the next
+// level down when a DNF first mentions it. The syntax is the one the options
+// name, else it follows the order string, or the first DNF added if the
+// order is empty. Returns NULL with errno EINVAL if the order is ambiguous.
+BDDManager* BDD_manager_create(const char *var_order, const BDDCreateOptions *options) {
+    BDDCreateOptions defaults = {0};
+    if (!options) options = &defaults;
+    if (!var_order) var_order = "";
+
+    DNFSyntax syntax = options->syntax;
+    if (syntax == DNF_SYNTAX_AUTO && *var_order) {
+        syntax = dnf_detect_syntax(var_order);
+        if (syntax == DNF_SYNTAX_AUTO) {
+            errno = EINVAL;
+            return NULL;
+        }
+    }
+    BDDManager *mgr = malloc(sizeof(BDDManager));
+    mgr->syntax = syntax; // DNF_SYNTAX_AUTO until the first DNF decides
+    var_table_init(&mgr->vars);
+    int listed;
+    int *listed_ids = parse_var_order(&mgr->vars, mgr->syntax, var_order, &listed);
+    bdd_set_order(mgr, listed_ids, listed);
+    free(listed_ids);
+    bdd_init_storage(mgr, options);
+    mgr->root = BDD_ZERO;
+    mgr->peak_nodes = mgr->arena.peak;
+    return mgr;
+}
+
+// Builds a DNF into the manager's node store and returns its handle,
+// protected until BDD_unprotect releases it. Subgraphs it shares with the
+// functions already added are stored once, and a DNF equivalent to one of
+// them gets the same handle. Returns BDD_NONE if the DNF uses name syntax
+// in a manager that reads letters or is the first and ambiguous, or if the manager's node limit (which
+// counts the nodes of every function it holds) or the memory cap stopped
+// the build; the manager and its other handles stay valid.
+BDDFunction BDD_manager_add(BDDManager *mgr, const char *dnf) {
+    if (!mgr || !dnf) return BDD_NONE;
+    uint64_t start = BDD_STATS_CLOCK();
+    DNFSyntax syntax = dnf_detect_syntax(dnf);
+    if (mgr->syntax == DNF_SYNTAX_AUTO) {
+        if (syntax == DNF_SYNTAX_AUTO) return BDD_NONE;
+        mgr->syntax = syntax;
+    } else if (mgr->syntax == DNF_SYNTAX_LETTERS && syntax == DNF_SYNTAX_NAMES) {
+        return BDD_NONE;
+    }
+
+    int term_count;
+    DNFTerm *terms = normalize_dnf(dnf, mgr->syntax, &mgr->vars, &term_count);
+    term_count = dnf_prune_terms(terms, term_count, mgr->vars.count);
+    bdd_add_new_vars(mgr);
+    resort_terms(mgr, terms, term_count);
+    BDD_STAT_ADD(mgr, phase_ns[BDD_PHASE_PARSE], BDD_STATS_CLOCK() - start);
+
+    bdd_begin_build(mgr);
+    BDDFunction f = bdd_end_build(mgr, bdd_build_terms(mgr, terms, term_count, mgr->build_mode));
+    if (mgr->arena.peak > (uint32_t)mgr->peak_nodes) mgr->peak_nodes = mgr->arena.peak;
+    free_terms(terms, term_count);
+    return f;
+}
+
+// Handles of one manager compare like the functions they stand for
+bool BDD_manager_equal(BDDFunction f, BDDFunction g) {
+    return f == g;
+}
+
+// Evaluates one function of the manager for an input string in BDD_use
+// form. Letter inputs are indexed by letter, named inputs by BDD_var_index.
+char BDD_manager_use(BDDManager *mgr, BDDFunction f, const char *inputs) {
+    if (!mgr || f == BDD_NONE || !inputs) return -1;
+    return bdd_eval(mgr, f, inputs);
+}
+
+// Number of nodes the listed functions use together, the terminal
+// included; a node they share is counted once
+int BDD_manager_nodes(BDDManager *mgr, const BDDFunction *fs, int count) {
+    if (!mgr || !fs) return 0;
+    return bdd_traverse(mgr, fs, count, NULL, NULL, NULL);
+}
+
+// OR of two functions of the manager as a new handle, protected like those
+// BDD_manager_add returns, or BDD_NONE if a limit stopped it. A manager
+// created with parallel_apply and several threads splits large ORs over them.
+BDDFunction BDD_manager_or(BDDManager *mgr, BDDFunction f, BDDFunction g) {
+    if (!mgr || f == BDD_NONE || g == BDD_NONE) return BDD_NONE;
+    bdd_begin_build(mgr);
+    BDDFunction result = bdd_or_parallel(mgr, f, g);
+    BDD_protect(mgr, result);
+    result = bdd_end_build(mgr, result);
+    bdd_maybe_collect(mgr);
+    return result;
+}
+
+// Copies one function into a BDD of its own, for the operations that work
+// on a whole BDD (counting, restriction, freezing, saving). It reads the
+// same input strings as the manager.
+BDD* BDD_manager_extract(BDDManager *mgr, BDDFunction f) {
+    if (!mgr || f == BDD_NONE) return NULL;
+    return bdd_extract(mgr, f);
+}
+
+// Helper function to generate a random permutation of variables(Fisher-Yates)
+void shuffle_order(int *order, int n, unsigned int *seed) {
+    for (int i = n - 1; i > 0; i--) {
+        int j = rand_r(seed) % (i + 1);
+        int temp = order[i];
+        order[i] = order[j];
+        order[j] = temp;
+    }
+}
+
+// Shared state of one BDD_create_with_best_order_ex run. Workers claim
+// candidate indices and keep the smallest BDD; the candidate's order
+// depends only on its index and the base seed, never on which worker
+// builds it. In sequential mode the live nodes at each checkpoint are the
+// result so far, so there a build is stopped once they exceed
+// ORDER_SEARCH_SLACK times the size of candidate 0, which is built before
+// any other. That budget is fixed before the workers start, so the
+// candidates that survive do not depend on the thread count. The other
+// modes hold many partial results at once, whose total says little about
+// the final size, and build every candidate to the end.
+#define ORDER_SEARCH_SLACK 2
+
+typedef struct
+{
+    const VarTable *vars;
+    DNFSyntax syntax;
+    const DNFTerm *terms;
+    int term_count;
+    const int *base_order; // alphabetical; candidate 0 uses it unshuffled
+    int candidates;
+    unsigned int seed;
+    const BDDCreateOptions *create;
+    int budget; // node limit of the candidates after the first, 0 for none
+
+    pthread_mutex_t lock;
+    int next_candidate;
+    BDD *best;
+    int best_size;
+    int best_index;
+} OrderSearch;
+
+// Builds candidate `index` within the search budget. Returns NULL if the
+// budget or a limit of the create options stopped it.
+static BDD *order_search_build(const OrderSearch *search, int index, int *order) {
+    int num_vars = search->vars->count;
+    memcpy(order, search->base_order, num_vars * sizeof(int));
+    if (index > 0) { // After first try, shuffle the order
+        unsigned int seed = search->seed ^ (unsigned int)index * 0x9E3779B9u;
+        shuffle_order(order, num_vars, &seed);
+    }
+
+    BDDCreateOptions create = *search->create;
+    if (search->budget > 0 && (create.node_limit <= 0 || search->budget < create.node_limit)) {
+        create.node_limit = search->budget;
+    }
+    BDD *candidate = bdd_create_from_terms(search->vars, search->syntax, search->terms,
+                                           search->term_count, order, num_vars, &create);
+    // Only the root is protected, so the live count is exactly the nodes
+    // it reaches; no traversal per candidate
+    if (candidate) candidate->node_count = bdd_live_nodes(candidate) + 1;
+    return candidate;
+}
+
+// Keeps the candidate if it beats the best so far and frees the loser.
+// Smallest BDD wins; equal sizes go to the lower candidate index so the
+// result does not depend on thread scheduling.
+static void order_search_offer(OrderSearch *search, BDD *candidate, int index) {
+    pthread_mutex_lock(&search->lock);
+    if (!search->best || candidate->node_count < search->best_size ||
+        (candidate->node_count == search->best_size && index < search->best_index)) {
+        BDD *previous = search->best;
+        search->best = candidate;
+        search->best_size = candidate->node_count;
+        search->best_index = index;
+        candidate = previous;
+    }
+    pthread_mutex_unlock(&search->lock);
+    BDD_free(candidate);
+}
+
+static void *order_search_worker(void *arg) {
+    OrderSearch *search = arg;
+    int *order = malloc(search->vars->count * sizeof(int));
+
+    for (;;) {
+        pthread_mutex_lock(&search->lock);
+        int index = search->next_candidate++;
+        pthread_mutex_unlock(&search->lock);
+        if (index >= search->candidates) break;
+
+        BDD *candidate = order_search_build(search, index, order);
+        if (candidate) order_search_offer(search, candidate, index);
+    }
+
+    free(order);
+    return NULL;
+}
+
+// Orders pointers into a VarTable's name array by the names they point at
+static int compare_name_refs(const void *a, const void *b) {
+    return strcmp(**(char **const *)a, **(char **const *)b);
+}
+
+BDD* BDD_create_with_best_order_ex(const char *dnf, const BDDOrderSearchOptions *options) {
+    BDDOrderSearchOptions defaults = {0};
+    if (!options) options = &defaults;
+    uint64_t start = BDD_STATS_CLOCK();
+
+    DNFSyntax syntax = dnf_choose_syntax(options->create.syntax, dnf, strlen(dnf), NULL);
+    if (syntax == DNF_SYNTAX_AUTO) {
+        errno = EINVAL;
+        return NULL;
+    }
+    VarTable vars;
+    var_table_init(&vars);
+    int term_count;
+    DNFTerm *terms = normalize_dnf(dnf, syntax, &vars, &term_count);
+    term_count = dnf_prune_terms(terms, term_count, vars.count);
+
+    int num_vars = vars.count;
+    if (num_vars == 0) {
+        free_terms(terms, term_count);
+        var_table_free(&vars);
+        return NULL;
+    }
     
-    BDDNode *current = bdd->root;
-    while (!current->is_terminal) {
-        char var = current->var_name;
-        int input_index = toupper(var) - 'A';
-        
-        if (input_index < 0 || input_index >= 26) {
-            return -1;
+    // Create initial order (alphabetical)
+    char ***by_name = malloc(num_vars * sizeof(char **));
+    for (int v = 0; v < num_vars; v++) by_name[v] = &vars.names[v];
+    qsort(by_name, num_vars, sizeof(char **), compare_name_refs);
+    int *base_order = malloc(num_vars * sizeof(int));
+    for (int i = 0; i < num_vars; i++) base_order[i] = (int)(by_name[i] - vars.names);
+    free(by_name);
+
+    OrderSearch search = {
+        .vars = &vars,
+        .syntax = syntax,
+        .terms = terms,
+        .term_count = term_count,
+        .base_order = base_order,
+        // Try at least N different orders (where N is number of variables)
+        .candidates = options->candidates > 0 ? options->candidates : num_vars * 2,
+        .seed = options->seed,
+        .create = &options->create,
+        .best = NULL,
+    };
+    pthread_mutex_init(&search.lock, NULL);
+
+    if (options->create.mode == BUILD_SEQUENTIAL) {
+        int *order = malloc(num_vars * sizeof(int));
+        BDD *first = order_search_build(&search, 0, order);
+        free(order);
+        if (first) {
+            search.budget = ORDER_SEARCH_SLACK * first->node_count;
+            order_search_offer(&search, first, 0);
         }
-        
-        if (inputs[input_index] != '0' && inputs[input_index] != '1') {
-            return -1;
+        search.next_candidate = 1;
+    }
+
+    int threads = options->threads > 0 ? options->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    if (threads > search.candidates) threads = search.candidates;
+
+    // The calling thread works as well, so only threads - 1 are spawned
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    int spawned = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[spawned], NULL, order_search_worker, &search) == 0) spawned++;
+    }
+    order_search_worker(&search);
+    for (int i = 0; i < spawned; i++) pthread_join(workers[i], NULL);
+
+    free(workers);
+    pthread_mutex_destroy(&search.lock);
+    free(base_order);
+    free_terms(terms, term_count);
+    var_table_free(&vars);
+    if (search.best) BDD_STAT_ADD(search.best, phase_ns[BDD_PHASE_ORDER_SEARCH], BDD_STATS_CLOCK() - start);
+    return search.best;
+}
+
+BDD* BDD_create_with_best_order(const char *dnf) {
+    return BDD_create_with_best_order_ex(dnf, NULL);
+}
+
+// Function to generate a random DNF expression
+char* generate_random_dnf(int var_count, int term_count) {
+    // 1. Гарантируем использование всех переменных
+    int required_terms = (term_count < var_count) ? var_count : term_count;
+
+    // A term holds at most var_count + 1 literals of two characters each,
+    // followed by a '+'; literals are appended through `end`
+    char* dnf = malloc((size_t)required_terms * (2 * var_count + 3) + 1);
+    char* end = dnf;
+    char* vars = malloc(var_count * sizeof(char));
+    
+    // Создаем массив переменных и перемешиваем его
+    for (int i = 0; i < var_count; i++) {
+        vars[i] = 'A' + i;
+    }
+    for (int i = var_count-1; i > 0; i--) { // Fisher-Yates shuffle
+        int j = rand() % (i+1);
+        char temp = vars[i];
+        vars[i] = vars[j];
+        vars[j] = temp;
+    }
+
+    // 2. Распределяем обязательные переменные
+    int vars_used = 0;
+    for (int t = 0; t < required_terms; t++) {
+        // Добавляем минимум одну новую переменную в каждый из первых var_count термов
+        if (t < var_count && vars_used < var_count) {
+            // Добавляем обязательную переменную
+            if (rand() % 2) *end++ = '!';
+            *end++ = vars[vars_used++];
+            
+            // Добавляем дополнительные переменные в терм
+            int extra_vars = rand() % (var_count - vars_used + 1);
+            for (int e = 0; e < extra_vars; e++) {
+                if (rand() % 2) *end++ = '!';
+                *end++ = vars[rand() % var_count];
+            }
+        }
+        else {
+            // Генерируем полностью случайный терм
+            int term_length = 1 + rand() % var_count;
+            bool used[26] = {false};
+            
+            for (int v = 0; v < term_length; v++) {
+                int var_idx;
+                do {
+                    var_idx = rand() % var_count;
+                } while (used[var_idx]);
+                used[var_idx] = true;
+                
+                if (rand() % 2) *end++ = '!';
+                *end++ = vars[var_idx];
+            }
         }
         
-        current = (inputs[input_index] == '1') ? current->high : current->low;
+        if (t < required_terms - 1) *end++ = '+';
+    }
+    *end = '\0';
+
+    free(vars);
+    return dnf;
+}
+
+// -------------------- Benchmarks --------------------
+// `main bench [options]` runs a seeded, reproducible suite and writes JSON
+// with wall-clock ns/op, node counts and peak RSS, so runs can be compared
+// across commits. The correctness tests stay in the default run.
+#define WORKLOAD_MAX_BITS 24 // the structured families have 2^bits - 1 terms
+
+static const char *workload_family_name(WorkloadFamily family) {
+    switch (family) {
+    case WORKLOAD_ADDER: return "adder";
+    case WORKLOAD_COMPARATOR: return "comparator";
+    default: return "random";
+    }
+}
+
+// Appends a term to `out` for bit i of a structured family: the fixed
+// literals of bit i, then one of the expansions of the bits above it
+// selected by `choice`
+static void workload_structured_term(FILE *out, WorkloadFamily family, int bits, int i, uint64_t choice) {
+    fprintf(out, family == WORKLOAD_ADDER ? "a%d & b%d" : "a%d & !b%d", i, i);
+    for (int j = i + 1; j < bits; j++, choice >>= 1) {
+        if (family == WORKLOAD_ADDER) {
+            // The carry from bit i propagates through a_j + b_j
+            fprintf(out, choice & 1 ? " & a%d" : " & b%d", j);
+        } else {
+            // Higher bits must be equal: a_j b_j + !a_j !b_j
+            fprintf(out, choice & 1 ? " & a%d & b%d" : " & !a%d & !b%d", j, j);
+        }
+    }
+}
+
+// Writes the workload as a name-syntax DNF ("x3 & !x7 + ..."). The same
+// spec always yields the same text, and the text is built with a memory
+// stream, so millions of terms cost linear time. Returns NULL for
+// structured families wider than WORKLOAD_MAX_BITS.
+char *workload_generate(const WorkloadSpec *spec, size_t *length) {
+    if (spec->vars < 1) return NULL;
+    if (spec->family != WORKLOAD_RANDOM && spec->vars > WORKLOAD_MAX_BITS) return NULL;
+
+    char *text = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&text, &size);
+    if (!out) return NULL;
+
+    if (spec->family == WORKLOAD_RANDOM) {
+        // Uniform terms over many variables have exponentially large BDDs
+        // in every order; a window gives the locality real rule sets have
+        unsigned int seed = spec->seed;
+        int window = spec->window > 0 && spec->window < spec->vars ? spec->window : spec->vars;
+        int literals = (int)(spec->density * window + 0.5);
+        if (literals < 1) literals = 1;
+        if (literals > window) literals = window;
+
+        // A partial Fisher-Yates shuffle picks each term's variables; the
+        // array stays a permutation, so it never needs resetting
+        int *pick = malloc(window * sizeof(int));
+        for (int v = 0; v < window; v++) pick[v] = v;
+        for (long t = 0; t < spec->terms; t++) {
+            if (t > 0) fputs(" + ", out);
+            int offset = rand_r(&seed) % (spec->vars - window + 1);
+            for (int k = 0; k < literals; k++) {
+                int j = k + rand_r(&seed) % (window - k);
+                int v = pick[j];
+                pick[j] = pick[k];
+                pick[k] = v;
+                fprintf(out, "%s%sx%d", k > 0 ? " & " : "", rand_r(&seed) & 1 ? "!" : "", offset + v);
+            }
+        }
+        free(pick);
+    } else {
+        bool first = true;
+        for (int i = spec->vars - 1; i >= 0; i--) {
+            for (uint64_t choice = 0; choice < 1ULL << (spec->vars - 1 - i); choice++) {
+                if (!first) fputs(" + ", out);
+                first = false;
+                workload_structured_term(out, spec->family, spec->vars, i, choice);
+            }
+        }
+    }
+
+    fclose(out);
+    if (length) *length = size;
+    return text;
+}
+
+// A good variable order for the workload: x0 x1 ... for random terms, so
+// windows stay contiguous, and the operand bits interleaved from the most
+// significant down for the structured families. The caller frees the
+// string.
+char *workload_order(const WorkloadSpec *spec) {
+    char *order = malloc((size_t)spec->vars * 24 + 1);
+    char *end = order;
+    *end = '\0';
+    for (int i = 0; i < spec->vars; i++) {
+        if (spec->family == WORKLOAD_RANDOM) end += sprintf(end, "x%d ", i);
+        else end += sprintf(end, "a%d b%d ", spec->vars - 1 - i, spec->vars - 1 - i);
+    }
+    return order;
+}
+
+static long bench_peak_rss_kb(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+    return usage.ru_maxrss; // kilobytes on Linux
+}
+
+// Appends one result object to the JSON "results" array. Node counts of -1
+// are left out; a BDD built with BDD_STATS adds its counters.
+static void bench_report(FILE *out, int *reported, const char *name, uint64_t ops, uint64_t elapsed_ns,
+                         int nodes, int peak_nodes, const BDD *bdd) {
+    fprintf(out, "%s\n    {\"name\": \"%s\", \"ops\": %llu, \"total_ns\": %llu, \"ns_per_op\": %.2f",
+            (*reported)++ ? "," : "", name, (unsigned long long)ops, (unsigned long long)elapsed_ns,
+            ops ? (double)elapsed_ns / ops : 0.0);
+    if (nodes >= 0) fprintf(out, ", \"nodes\": %d", nodes);
+    if (peak_nodes >= 0) fprintf(out, ", \"peak_nodes\": %d", peak_nodes);
+    fprintf(out, ", \"peak_rss_kb\": %ld", bench_peak_rss_kb());
+    if (bdd && BDD_STATS) {
+        fprintf(out, ", \"stats\": ");
+        BDD_stats_json(bdd, out);
+    }
+    fputc('}', out);
+}
+
+// Times BDD_use, BDD_frozen_use and BDD_frozen_use_batch on `evals`
+// seeded random assignments
+static void bench_evaluation(FILE *out, int *reported, BDD *bdd, long evals, unsigned int seed) {
+    enum { POOL = 1024, BATCH = 1 << 16 };
+    int width = BDD_input_width(bdd);
+    char *pool = malloc((size_t)POOL * (width + 1));
+    for (int i = 0; i < POOL; i++) {
+        char *inputs = pool + (size_t)i * (width + 1);
+        for (int j = 0; j < width; j++) inputs[j] = rand_r(&seed) & 1 ? '1' : '0';
+        inputs[width] = '\0';
+    }
+    volatile unsigned int sink = 0; // keeps the loops from being optimized away
+
+    uint64_t start = bdd_now_ns();
+    for (long i = 0; i < evals; i++) sink += BDD_use(bdd, pool + (size_t)(i % POOL) * (width + 1));
+    bench_report(out, reported, "eval_use", evals, bdd_now_ns() - start, -1, -1, NULL);
+
+    BDDFrozen *frozen = BDD_freeze(bdd);
+    start = bdd_now_ns();
+    for (long i = 0; i < evals; i++) sink += BDD_frozen_use(frozen, pool + (size_t)(i % POOL) * (width + 1));
+    bench_report(out, reported, "eval_frozen", evals, bdd_now_ns() - start, frozen->count, -1, NULL);
+
+    size_t words = BDD_batch_words(BATCH);
+    uint64_t *inputs = malloc((size_t)width * words * sizeof(uint64_t) + sizeof(uint64_t));
+    uint64_t *results = malloc(words * sizeof(uint64_t));
+    for (size_t i = 0; i < (size_t)width * words; i++)
+        inputs[i] = (uint64_t)rand_r(&seed) << 42 ^ (uint64_t)rand_r(&seed) << 21 ^ (uint64_t)rand_r(&seed);
+    long batches = (evals + BATCH - 1) / BATCH;
+    start = bdd_now_ns();
+    for (long b = 0; b < batches; b++) {
+        BDD_frozen_use_batch(frozen, inputs, BATCH, results);
+        sink += (unsigned int)results[0];
+    }
+    bench_report(out, reported, "eval_batch", (uint64_t)batches * BATCH, bdd_now_ns() - start, -1, -1, NULL);
+
+    free(results);
+    free(inputs);
+    BDD_frozen_free(frozen);
+    free(pool);
+    (void)sink;
+}
+
+static void bench_usage(void) {
+    fprintf(stderr,
+            "usage: bench [--family random|adder|comparator] [--vars N] [--terms N] [--density X]\n"
+            "             [--window N] [--seed N] [--evals N] [--search-bits N] [--candidates N]\n"
+            "             [--threads N] [--out FILE]\n");
+}
+
+// Entry point of the `bench` subcommand. Builds the workload with every
+// construction mode and with streaming, searches orders on a comparator
+// (whose size depends strongly on the order) and measures evaluation.
+// With --threads above 1 the builds opt in to parallel apply.
+int run_benchmarks(int argc, char **argv) {
+    WorkloadSpec spec = {
+        .family = WORKLOAD_RANDOM, .vars = 64, .terms = 1000, .density = 0.75, .window = 12, .seed = 1,
+    };
+    long evals = 1000000;
+    int search_bits = 8, candidates = 0, threads = 0;
+    const char *out_path = NULL;
+
+    for (int i = 0; i < argc; i++) {
+        const char *arg = argv[i], *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value) {
+            bench_usage();
+            return 2;
+        }
+        if (strcmp(arg, "--family") == 0) {
+            if (strcmp(value, "adder") == 0) spec.family = WORKLOAD_ADDER;
+            else if (strcmp(value, "comparator") == 0) spec.family = WORKLOAD_COMPARATOR;
+            else if (strcmp(value, "random") == 0) spec.family = WORKLOAD_RANDOM;
+            else {
+                fprintf(stderr, "bench: unknown workload family %s\n", value);
+                return 2;
+            }
+        } else if (strcmp(arg, "--vars") == 0) spec.vars = atoi(value);
+        else if (strcmp(arg, "--terms") == 0) spec.terms = atol(value);
+        else if (strcmp(arg, "--density") == 0) spec.density = atof(value);
+        else if (strcmp(arg, "--window") == 0) spec.window = atoi(value);
+        else if (strcmp(arg, "--seed") == 0) spec.seed = (unsigned int)strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--evals") == 0) evals = atol(value);
+        else if (strcmp(arg, "--search-bits") == 0) search_bits = atoi(value);
+        else if (strcmp(arg, "--candidates") == 0) candidates = atoi(value);
+        else if (strcmp(arg, "--threads") == 0) threads = atoi(value);
+        else if (strcmp(arg, "--out") == 0) out_path = value;
+        else {
+            bench_usage();
+            return 2;
+        }
+        i++;
+    }
+
+    uint64_t start = bdd_now_ns();
+    size_t length;
+    char *dnf = workload_generate(&spec, &length);
+    uint64_t generated = bdd_now_ns() - start;
+    if (!dnf) {
+        fprintf(stderr, "bench: cannot generate a %s workload with %d variables\n",
+                workload_family_name(spec.family), spec.vars);
+        return 1;
+    }
+    long terms = 1;
+    for (const char *p = dnf; *p; p++) terms += *p == '+';
+
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "bench: cannot open %s: %s\n", out_path, strerror(errno));
+        free(dnf);
+        return 1;
+    }
+    fprintf(out, "{\n  \"seed\": %u,\n  \"workload\": {\"family\": \"%s\", \"vars\": %d, \"terms\": %ld, "
+                 "\"density\": %.3f, \"window\": %d, \"bytes\": %zu},\n  \"results\": [",
+            spec.seed, workload_family_name(spec.family), spec.vars, terms, spec.density, spec.window, length);
+    int reported = 0;
+    bench_report(out, &reported, "generate", terms, generated, -1, -1, NULL);
+
+    char *order = workload_order(&spec);
+    static const char *const mode_names[] = {"create_sequential", "create_balanced", "create_clustered"};
+    for (BDDBuildMode mode = BUILD_SEQUENTIAL; mode <= BUILD_CLUSTERED; mode++) {
+        BDDCreateOptions options = {.mode = mode, .threads = threads, .parallel_apply = threads > 1};
+        start = bdd_now_ns();
+        BDD *bdd = BDD_create_ex(dnf, order, &options);
+        uint64_t elapsed = bdd_now_ns() - start;
+        update_node_count(bdd);
+        bench_report(out, &reported, mode_names[mode], terms, elapsed, bdd->node_count, bdd->peak_nodes, bdd);
+        BDD_free(bdd);
+    }
+
+    BDDCreateOptions streaming = {.mode = BUILD_BALANCED, .threads = threads, .parallel_apply = threads > 1};
+    start = bdd_now_ns();
+    BDD *bdd = BDD_create_from_memory(dnf, length, order, &streaming);
+    uint64_t elapsed = bdd_now_ns() - start;
+    update_node_count(bdd);
+    bench_report(out, &reported, "create_streaming", terms, elapsed, bdd->node_count, bdd->peak_nodes, bdd);
+
+    bench_evaluation(out, &reported, bdd, evals, spec.seed);
+    BDD_free(bdd);
+    free(order);
+    free(dnf);
+
+    // The search reports time per candidate order and the size it found
+    WorkloadSpec comparator = {.family = WORKLOAD_COMPARATOR, .vars = search_bits, .seed = spec.seed};
+    char *search_dnf = workload_generate(&comparator, NULL);
+    if (search_dnf) {
+        BDDOrderSearchOptions options = {.candidates = candidates, .seed = spec.seed};
+        int tried = candidates > 0 ? candidates : 2 * 2 * search_bits;
+        start = bdd_now_ns();
+        BDD *best = BDD_create_with_best_order_ex(search_dnf, &options);
+        elapsed = bdd_now_ns() - start;
+        update_node_count(best);
+        bench_report(out, &reported, "order_search", tried, elapsed, best->node_count, best->peak_nodes, best);
+        BDD_free(best);
+        free(search_dnf);
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) fclose(out);
+    return 0;
+}
+
+// -------------------- Tests --------------------
+// Checks the BDD against its DNF on every input combination
+void test_all_combinations(BDD* bdd, const char* dnf, int var_count) {
+    printf("Testing all combinations for DNF: %s\n", dnf);
+
+    BDDVerifyResult result;
+    if (BDD_verify_dnf(bdd, dnf, 0, &result) != 0) {
+        printf("Cannot verify %d inputs against this DNF\n\n", var_count);
+        return;
+    }
+
+    if (result.equivalent) {
+        printf("Passed %llu/%llu tests (100.00%%)\n\n", (unsigned long long)result.checked,
+               (unsigned long long)result.checked);
+    } else {
+        printf("Test failed for inputs %s: expected %c, got %c\n", result.counterexample,
+               result.expected, result.actual);
+        printf("First counterexample after %llu of %llu tests\n\n", (unsigned long long)result.checked,
+               1ULL << var_count);
+        free(result.counterexample);
     }
-    
-    return current->value;
 }
 
-BDD* BDD_create(const char *dnf, const char *var_order) {
-    int term_count;
-    DNFTerm *terms = normalize_dnf(dnf, var_order, &term_count);
-
-    BDD *bdd = malloc(sizeof(BDD));
-    bdd->var_order = strdup(var_order);
-    bdd->var_count = strlen(var_order);
+// Function to test BDD creation and measure reduction
+void test_bdd_creation(const char* dnf, const char* order) {
+    printf("Testing BDD creation for DNF: %s\n", dnf);
+    printf("Using order: %s\n", order);
     
-    // Initialize counts FIRST
-    bdd->node_count = 0;
-    bdd->unique.size = 0;
-    bdd->unique.capacity = 10;
-    bdd->unique.nodes = malloc(10 * sizeof(BDDNode*));
+    clock_t start = clock();
+    BDD* bdd = BDD_create(dnf, order);
+    clock_t end = clock();
+    
+    printf("Creation time: %.2f ms\n", (double)(end - start) * 1000 / CLOCKS_PER_SEC);
+    printf("Node count: %d\n", bdd->node_count);
+    printf("Peak nodes: %d\n", bdd->peak_nodes);
     
-    // Create terminals first
-    BDDNode *zero = create_terminal_node(bdd, '0');
-    BDDNode *one = create_terminal_node(bdd, '1');
+    test_all_combinations(bdd, dnf, BDD_input_width(bdd));
     
-    BDDNode *result = zero;
+    // Cleanup
+    BDD_free(bdd);
+}
 
-    for (int i = 0; i < term_count; i++) {
-        if (terms[i].length == 0) continue;
-        BDDNode *term_bdd = build_term_bdd(bdd, &terms[i], 0);
-        result = bdd_or(bdd, result, term_bdd);
+// Builds one term over `literals` named variables, listed in the order
+// string in reverse, so sort_term_vars has to reorder the whole term. The
+// result is a single chain of one node per variable.
+void test_long_term(int literals) {
+    printf("Testing a term of %d literals\n", literals);
+    size_t capacity = (size_t)literals * 16 + 1;
+    char* dnf = malloc(capacity);
+    char* order = malloc(capacity);
+    char* d = dnf;
+    char* o = order;
+    for (int i = 0; i < literals; i++) {
+        d += sprintf(d, "%sv%d", i ? " & " : "", i);
+        o += sprintf(o, "%sv%d", i ? " " : "", literals - 1 - i);
     }
 
-    bdd->root = result;
+    BDD* bdd = BDD_create(dnf, order);
+    update_node_count(bdd);
+    int passed = bdd->node_count == literals + 1;
+    char* inputs = malloc(literals + 1);
+    inputs[literals] = '\0';
+    memset(inputs, '1', literals);
+    passed += BDD_use(bdd, inputs) == '1';
+    inputs[literals / 2] = '0';
+    passed += BDD_use(bdd, inputs) == '0';
+    printf("%d nodes\n", bdd->node_count);
+    printf("Passed %d/3 tests (%.2f%%)\n\n", passed, 100.0 * passed / 3);
 
-    for (int i = 0; i < term_count; i++) free(terms[i].vars);
-    free(terms);
-    return bdd;
+    free(inputs);
+    BDD_free(bdd);
+    free(order);
+    free(dnf);
 }
 
-// Helper function to generate a random permutation of variables(Fisher-Yates)
-void shuffle_order(char *order, int n) {
-    for (int i = n - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
-        char temp = order[i];
-        order[i] = order[j];
-        order[j] = temp;
+// Builds a DNF of plain words, which reads as names or as letters. The
+// default has to refuse it rather than guess, while an explicit syntax
+// gets one variable per word or per distinct letter.
+void test_syntax(const char* dnf, const char* order) {
+    printf("Testing syntax selection for DNF: %s\n", dnf);
+    int words = 0, letters = 0;
+    bool seen[26] = {false};
+    for (const char* p = order; *p; p++) {
+        words += isalpha((unsigned char)*p) && (p == order || !isalpha((unsigned char)p[-1]));
+    }
+    for (const char* p = dnf; *p; p++) {
+        if (isalpha((unsigned char)*p) && !seen[toupper((unsigned char)*p) - 'A']) {
+            seen[toupper((unsigned char)*p) - 'A'] = true;
+            letters++;
+        }
+    }
+
+    int passed = 0, total = 0;
+    errno = 0;
+    BDD* guessed = BDD_create(dnf, order);
+    passed += !guessed && errno == EINVAL;
+    errno = 0;
+    BDD* streamed = BDD_create_from_memory(dnf, strlen(dnf), order, NULL);
+    passed += !streamed && errno == EINVAL;
+    BDDManager* mgr = BDD_manager_create(order, NULL);
+    passed += !mgr;
+    total += 3;
+
+    BDDCreateOptions names = {.syntax = DNF_SYNTAX_NAMES}, single = {.syntax = DNF_SYNTAX_LETTERS};
+    BDD* by_name = BDD_create_ex(dnf, order, &names);
+    BDD* by_letter = BDD_create_ex(dnf, "", &single);
+    passed += by_name && by_name->var_count == words;
+    passed += by_letter && by_letter->var_count == letters;
+    total += 2;
+    printf("Names: %d variables, letters: %d variables\n", by_name ? by_name->var_count : -1,
+           by_letter ? by_letter->var_count : -1);
+
+    // Streaming sees the first chunk only when it settles the syntax; a
+    // name after it must fail the build rather than be read as letters
+    size_t padding = DNF_CHUNK_SIZE;
+    char* late = malloc(padding + sizeof("x_1"));
+    for (size_t i = 0; i < padding; i += 2) memcpy(late + i, "A+", 2);
+    strcpy(late + padding, "x_1");
+    BDD* whole = BDD_create(late, "");
+    errno = 0;
+    BDD* chunked = BDD_create_from_memory(late, strlen(late), "", NULL);
+    passed += whole && whole->syntax == DNF_SYNTAX_NAMES && !chunked && errno == EINVAL;
+    chunked = BDD_create_from_memory(late, strlen(late), "", &names);
+    passed += whole && chunked && chunked->var_count == whole->var_count;
+    total += 2;
+    printf("Passed %d/%d tests (%.2f%%)\n\n", passed, total, 100.0 * passed / total);
+    BDD_free(chunked);
+    BDD_free(whole);
+    free(late);
+
+    if (by_name) test_all_combinations(by_name, dnf, BDD_input_width(by_name));
+    BDD_free(by_name);
+    BDD_free(by_letter);
+}
+
+// Builds the same DNF with every construction mode
+void test_build_modes(const char* dnf, const char* order) {
+    static const char *mode_names[] = {"sequential", "balanced", "clustered"};
+    printf("Testing construction modes for DNF: %s\n", dnf);
+
+    for (int mode = BUILD_SEQUENTIAL; mode <= BUILD_CLUSTERED; mode++) {
+        BDDCreateOptions options = {.mode = (BDDBuildMode)mode};
+
+        clock_t start = clock();
+        BDD* bdd = BDD_create_ex(dnf, order, &options);
+        clock_t end = clock();
+        update_node_count(bdd);
+
+        printf("Mode %s: %.2f ms, %d nodes, peak %d\n", mode_names[mode],
+               (double)(end - start) * 1000 / CLOCKS_PER_SEC, bdd->node_count, bdd->peak_nodes);
+        test_all_combinations(bdd, dnf, BDD_input_width(bdd));
+        BDD_free(bdd);
     }
 }
 
-// Helper function to count unique variables in DNF
-int count_unique_vars(const char *dnf) {
-    bool vars[26] = {false};
-    for (const char *p = dnf; *p; p++) {
-        if (isalpha(*p)) {
-            vars[toupper(*p) - 'A'] = true;
+// Builds with the given order, then sifts the finished BDD in place
+void test_reorder(const char* dnf, const char* order) {
+    printf("Testing in-place reordering for DNF: %s\n", dnf);
+
+    BDD* bdd = BDD_create(dnf, order);
+    update_node_count(bdd);
+    printf("Before sifting: %d nodes with order %s\n", bdd->node_count, order);
+
+    clock_t start = clock();
+    BDD_reorder(bdd);
+    clock_t end = clock();
+    update_node_count(bdd);
+
+    char *sifted = BDD_order_string(bdd);
+    printf("After sifting: %d nodes with order %s (%.2f ms)\n", bdd->node_count, sifted,
+           (double)(end - start) * 1000 / CLOCKS_PER_SEC);
+    free(sifted);
+
+    test_all_combinations(bdd, dnf, BDD_input_width(bdd));
+    BDD_free(bdd);
+}
+
+// Compares BDD_sat_count with enumeration and checks that sampled
+// assignments and enumerated cubes are consistent with it
+void test_model_counting(const char* dnf, const char* order) {
+    printf("Testing model counting for DNF: %s\n", dnf);
+
+    BDD* bdd = BDD_create(dnf, order);
+    int width = BDD_input_width(bdd);
+    size_t count = (size_t)1 << width;
+    size_t words = BDD_batch_words(count);
+    uint64_t *inputs = calloc((size_t)width * words, sizeof(uint64_t));
+    for (size_t k = 0; k < count; k++) {
+        for (int j = 0; j < width; j++) {
+            if (k & ((size_t)1 << (width - j - 1))) inputs[j * words + k / 64] |= 1ULL << (k % 64);
         }
     }
-    int count = 0;
-    for (int i = 0; i < 26; i++) {
-        if (vars[i]) count++;
+    uint64_t *results = malloc(words * sizeof(uint64_t));
+    BDD_use_batch(bdd, inputs, count, results);
+    double enumerated = 0;
+    for (size_t w = 0; w < words; w++) enumerated += __builtin_popcountll(results[w]);
+    // Input positions no variable uses multiply the enumerated count
+    for (int unused = width - bdd->var_count; unused > 0; unused--) enumerated /= 2;
+    printf("Satisfying assignments: %.0f (enumeration: %.0f)\n", BDD_sat_count(bdd), enumerated);
+
+    char* assignment = malloc(width + 1);
+    if (BDD_any_sat(bdd, assignment) == 0)
+        printf("Some solution: %s -> %c\n", assignment, BDD_use(bdd, assignment));
+
+    int samples = 1000, satisfied = 0;
+    unsigned int seed = 1;
+    char* drawn = malloc((size_t)samples * (width + 1));
+    if (BDD_sample_sat(bdd, &seed, drawn, samples) == 0) {
+        for (int n = 0; n < samples; n++) satisfied += BDD_use(bdd, drawn + (size_t)n * (width + 1)) == '1';
     }
-    return count;
+    printf("Samples satisfying the function: %d/%d\n", satisfied, samples);
+
+    int cubes = 0;
+    double covered = 0;
+    BDDCubeIterator* it = BDD_cubes_begin(bdd);
+    while (BDD_cubes_next(it, assignment)) {
+        double size = 1;
+        for (int v = 0; v < bdd->var_count; v++) size *= assignment[bdd->input_slot[v]] == '-' ? 2 : 1;
+        covered += size;
+        cubes++;
+    }
+    BDD_cubes_end(it);
+    printf("Cubes: %d covering %.0f assignments\n\n", cubes, covered);
+
+    free(drawn);
+    free(assignment);
+    free(results);
+    free(inputs);
+    BDD_free(bdd);
 }
 
-BDD* BDD_create_with_best_order(const char *dnf) {
-    srand(time(NULL)); // Seed random number generator
-    
-    int num_vars = count_unique_vars(dnf);
-    if (num_vars == 0) return NULL;
-    
-    // Create initial order (alphabetical)
-    char base_order[26];
-    int pos = 0;
-    for (int i = 0; i < 26; i++) {
-        if (strchr(dnf, 'A' + i) || strchr(dnf, 'a' + i)) {
-            base_order[pos++] = 'A' + i;
-        }
+// Checks a restricted and two quantified BDDs against the original on
+// every input combination
+void test_restrict(const char* dnf, const char* order, const char* assignment, const char* vars) {
+    printf("Testing restriction and quantification for DNF: %s\n", dnf);
+
+    BDD* bdd = BDD_create(dnf, order);
+    update_node_count(bdd);
+    int nodes = bdd->node_count;
+    BDD* restricted = BDD_restrict(bdd, assignment);
+    BDD* exists = BDD_exists(bdd, vars);
+    BDD* forall = BDD_forall(bdd, vars);
+    printf("Nodes: %d, restricted to %s: %d, exists %s: %d, forall %s: %d\n", nodes, assignment,
+           restricted->node_count, vars, exists->node_count, vars, forall->node_count);
+
+    int width = BDD_input_width(bdd);
+    int* slots = malloc((width + 1) * sizeof(int));
+    int quantified = 0;
+    for (const char* p = vars; *p;) {
+        int var = is_var_start(bdd->syntax, *p) ? find_var_at(&bdd->vars, bdd->syntax, &p) : (p++, -1);
+        if (var >= 0) slots[quantified++] = bdd->input_slot[var];
     }
-    base_order[pos] = '\0';
-    
-    BDD *best_bdd = NULL;
-    int best_size = INT_MAX;
-    
-    // Try at least N different orders (where N is number of variables)
-    for (int i = 0; i < num_vars * 2; i++) {
-        char current_order[27];
-        strcpy(current_order, base_order);
-        
-        if (i > 0) { // After first try, shuffle the order
-            shuffle_order(current_order, num_vars);
-        }
-        
-        BDD *temp_bdd = BDD_create(dnf, current_order);
-        update_node_count(temp_bdd); // Ensure accurate node count
-        
-        if (!best_bdd || temp_bdd->node_count < best_size) {
-            if (best_bdd) {
-                // Free previous best BDD
-                for (int j = 0; j < best_bdd->unique.size; j++) 
-                    free(best_bdd->unique.nodes[j]);
-                free(best_bdd->unique.nodes);
-                free(best_bdd->var_order);
-                free(best_bdd);
-            }
-            best_bdd = temp_bdd;
-            best_size = temp_bdd->node_count;
-        } else {
-            // Free the temporary BDD
-            for (int j = 0; j < temp_bdd->unique.size; j++) 
-                free(temp_bdd->unique.nodes[j]);
-            free(temp_bdd->unique.nodes);
-            free(temp_bdd->var_order);
-            free(temp_bdd);
+
+    char* inputs = malloc(width + 1);
+    char* fixed = malloc(width + 1);
+    inputs[width] = fixed[width] = '\0';
+    int passed = 0, total = 1 << width;
+    for (int i = 0; i < total; i++) {
+        for (int j = 0; j < width; j++) inputs[j] = (i & (1 << (width - j - 1))) ? '1' : '0';
+        bool any = false, all = true;
+        for (int k = 0; k < 1 << quantified; k++) {
+            memcpy(fixed, inputs, width);
+            for (int q = 0; q < quantified; q++) fixed[slots[q]] = (k >> q) & 1 ? '1' : '0';
+            bool value = BDD_use(bdd, fixed) == '1';
+            any |= value;
+            all &= value;
         }
+        for (int j = 0; j < width; j++) fixed[j] = assignment[j] == '0' || assignment[j] == '1' ? assignment[j] : inputs[j];
+        passed += BDD_use(restricted, inputs) == BDD_use(bdd, fixed) && (BDD_use(exists, inputs) == '1') == any &&
+                  (BDD_use(forall, inputs) == '1') == all;
     }
-    
-    return best_bdd;
+    printf("Passed %d/%d tests (%.2f%%)\n\n", passed, total, 100.0 * passed / total);
+
+    free(fixed);
+    free(inputs);
+    free(slots);
+    BDD_free(forall);
+    BDD_free(exists);
+    BDD_free(restricted);
+    BDD_free(bdd);
 }
 
-// Function to generate a random DNF expression
-char* generate_random_dnf(int var_count, int term_count) {
-    char* dnf = malloc(1000 * sizeof(char));
-    dnf[0] = '\0';
+// Loads a catalog of related rules into one manager: every prefix of the
+// DNF's terms, then the full DNF with its terms reversed. Each handle is
+// checked against a separately built BDD on every input, and two handles
+// must be equal exactly when those BDDs have the same truth table.
+void test_manager(const char* dnf, const char* order) {
+    printf("Testing shared manager for prefixes of DNF: %s\n", dnf);
 
-    // 1. Гарантируем использование всех переменных
-    int required_terms = (term_count < var_count) ? var_count : term_count;
-    char* vars = malloc(var_count * sizeof(char));
-    
-    // Создаем массив переменных и перемешиваем его
-    for (int i = 0; i < var_count; i++) {
-        vars[i] = 'A' + i;
+    int term_count = 1;
+    for (const char* p = dnf; *p; p++) term_count += *p == '+';
+    int count = term_count + 1;
+    char** rules = malloc(count * sizeof(char*));
+    size_t length = strlen(dnf);
+    for (int i = 0, end = 0; i < term_count; i++) {
+        while (dnf[end] && dnf[end] != '+') end++;
+        rules[i] = strndup(dnf, end);
+        end++;
     }
-    for (int i = var_count-1; i > 0; i--) { // Fisher-Yates shuffle
-        int j = rand() % (i+1);
-        char temp = vars[i];
-        vars[i] = vars[j];
-        vars[j] = temp;
+    rules[term_count] = malloc(length + 1);
+    for (size_t end = length, out = 0; end > 0;) {
+        size_t start = end;
+        while (start > 0 && dnf[start - 1] != '+') start--;
+        memcpy(rules[term_count] + out, dnf + start, end - start);
+        out += end - start;
+        rules[term_count][out++] = start > 0 ? '+' : '\0';
+        end = start > 0 ? start - 1 : 0;
     }
 
-    // 2. Распределяем обязательные переменные
-    int vars_used = 0;
-    for (int t = 0; t < required_terms; t++) {
-        // Добавляем минимум одну новую переменную в каждый из первых var_count термов
-        if (t < var_count && vars_used < var_count) {
-            // Добавляем обязательную переменную
-            if (rand() % 2) strcat(dnf, "!");
-            char var_str[2] = {vars[vars_used++], '\0'};
-            strcat(dnf, var_str);
-            
-            // Добавляем дополнительные переменные в терм
-            int extra_vars = rand() % (var_count - vars_used + 1);
-            for (int e = 0; e < extra_vars; e++) {
-                strcat(dnf, (rand() % 2) ? "!" : "");
-                char extra_str[2] = {vars[rand() % var_count], '\0'};
-                strcat(dnf, extra_str);
-            }
+    BDDManager* mgr = BDD_manager_create(order, NULL);
+    BDDFunction* handles = malloc(count * sizeof(BDDFunction));
+    BDD** separate = malloc(count * sizeof(BDD*));
+    int separate_nodes = 0;
+    for (int i = 0; i < count; i++) {
+        handles[i] = BDD_manager_add(mgr, rules[i]);
+        separate[i] = BDD_create(rules[i], order);
+        update_node_count(separate[i]);
+        separate_nodes += separate[i]->node_count;
+    }
+    BDD_collect_garbage(mgr);
+    printf("%d functions: %d nodes in separate BDDs, %d in the shared manager\n", count, separate_nodes,
+           BDD_manager_nodes(mgr, handles, count));
+
+    int width = BDD_input_width(mgr);
+    int total = 1 << width;
+    size_t words = BDD_batch_words(total);
+    uint64_t* tables = calloc(count * words, sizeof(uint64_t));
+    char* inputs = malloc(width + 1);
+    inputs[width] = '\0';
+    int passed = 0, tests = 0;
+    for (int k = 0; k < total; k++) {
+        for (int j = 0; j < width; j++) inputs[j] = (k & (1 << (width - j - 1))) ? '1' : '0';
+        for (int i = 0; i < count; i++) {
+            char value = BDD_use(separate[i], inputs);
+            passed += BDD_manager_use(mgr, handles[i], inputs) == value;
+            if (value == '1') tables[i * words + k / 64] |= 1ULL << (k % 64);
         }
-        else {
-            // Генерируем полностью случайный терм
-            int term_length = 1 + rand() % var_count;
-            bool used[26] = {false};
-            
-            for (int v = 0; v < term_length; v++) {
-                int var_idx;
-                do {
-                    var_idx = rand() % var_count;
-                } while (used[var_idx]);
-                used[var_idx] = true;
-                
-                strcat(dnf, (rand() % 2) ? "!" : "");
-                char var_str[2] = {vars[var_idx], '\0'};
-                strcat(dnf, var_str);
-            }
+        tests += count;
+    }
+    int distinct = 0;
+    for (int i = 0; i < count; i++) {
+        bool first = true;
+        for (int j = 0; j < i; j++) {
+            bool same = memcmp(tables + i * words, tables + j * words, words * sizeof(uint64_t)) == 0;
+            passed += BDD_manager_equal(handles[i], handles[j]) == same;
+            tests++;
+            first &= !same;
         }
-        
-        if (t < required_terms - 1) strcat(dnf, "+");
+        distinct += first;
     }
+    printf("Distinct functions: %d of %d\n", distinct, count);
+    printf("Passed %d/%d tests (%.2f%%)\n\n", passed, tests, 100.0 * passed / tests);
 
-    free(vars);
-    return dnf;
+    for (int i = 0; i < count; i++) {
+        BDD_unprotect(mgr, handles[i]);
+        BDD_free(separate[i]);
+        free(rules[i]);
+    }
+    free(inputs);
+    free(tables);
+    free(separate);
+    free(handles);
+    free(rules);
+    BDD_free(mgr);
 }
 
-// Function to evaluate a DNF expression directly
-char evaluate_dnf(const char* dnf, const char* inputs) {
-    // Make a copy we can modify
-    char* expr = strdup(dnf);
-    char* term = strtok(expr, "+");
-    
-    while (term != NULL) {
-        bool term_true = true;
-        char* p = term;
-        
-        while (*p) {
-            // Skip whitespace
-            if (*p == ' ') {
-                p++;
-                continue;
-            }
-            
-            bool negated = false;
-            if (*p == '!') {
-                negated = true;
-                p++;
-                // Skip whitespace after negation
-                while (*p == ' ') p++;
-            }
-            
-            if (isalpha(*p)) {
-                char var = toupper(*p);
-                int var_idx = var - 'A';
-                
-                // Default to false if variable not in inputs
-                bool var_value = false;
-                
-                // Check if variable exists in inputs
-                if (var_idx >= 0 && var_idx < strlen(inputs)) {
-                    var_value = (inputs[var_idx] == '1');
-                }
-                
-                if (negated) {
-                    var_value = !var_value;
-                }
-                
-                if (!var_value) {
-                    term_true = false;
-                    break;
-                }
-            }
-            
-            p++;
-        }
-        
-        if (term_true) {
-            free(expr);
-            return '1';
-        }
-        
-        term = strtok(NULL, "+");
+// Prints the statistics gathered while building the BDD; they are only
+// complete in a build with -DBDD_STATS=1
+void test_stats(const char* dnf, const char* order) {
+    printf("Testing statistics for DNF: %s\n", dnf);
+
+    BDD* bdd = BDD_create(dnf, order);
+    BDD_stats_json(bdd, stdout);
+    printf("\n");
+
+    BDDStats stats;
+    BDD_get_stats(bdd, &stats);
+    unsigned long hits, misses;
+    BDD_cache_stats(bdd, &hits, &misses);
+    printf("Counters %s; peak %u nodes, %u live, cache %lu/%lu hits\n\n", stats.enabled ? "enabled" : "disabled",
+           stats.peak_nodes, stats.live_nodes, stats.cache_hits, hits + misses);
+    BDD_free(bdd);
+}
+
+// Reports how many terms the redundancy pass removes, then checks that the
+// BDD built from the pruned terms still matches the full DNF
+void test_term_pruning(const char* dnf, const char* order) {
+    printf("Testing term pruning for DNF: %s\n", dnf);
+
+    VarTable vars;
+    var_table_init(&vars);
+    int term_count;
+    DNFTerm* terms = normalize_dnf(dnf, dnf_detect_syntax(dnf), &vars, &term_count);
+    int kept = dnf_prune_terms(terms, term_count, vars.count);
+    printf("Kept %d of %d terms:", kept, term_count);
+    for (int t = 0; t < kept; t++) {
+        printf(" ");
+        print_term(&terms[t], &vars);
     }
-    
-    free(expr);
-    return '0';
+    printf("\n");
+    free_terms(terms, kept);
+    var_table_free(&vars);
+
+    BDD* bdd = BDD_create(dnf, order);
+    test_all_combinations(bdd, dnf, BDD_input_width(bdd));
+    BDD_free(bdd);
 }
 
-// Function to generate all possible input combinations
-void test_all_combinations(BDD* bdd, const char* dnf, int var_count) {
-    printf("Testing all combinations for DNF: %s\n", dnf);
-    
-    char* inputs = malloc((var_count + 1) * sizeof(char));
-    inputs[var_count] = '\0';
-    
-    int total_tests = 1 << var_count;
-    int passed = 0;
-    
-    // Bitmask enumeration
-    for (int i = 0; i < total_tests; i++) {
-        // Generate binary string
-        for (int j = 0; j < var_count; j++) {
-            inputs[j] = (i & (1 << (var_count - j - 1))) ? '1' : '0';
+// Streams the DNF from a file and checks the result against BDD_create
+void test_streaming(const char* dnf, const char* order) {
+    printf("Testing streaming construction for DNF: %s\n", dnf);
+
+    FILE* file = tmpfile();
+    fputs(dnf, file);
+    rewind(file);
+
+    BDD* reference = BDD_create(dnf, order);
+    update_node_count(reference);
+    for (BDDBuildMode mode = BUILD_SEQUENTIAL; mode <= BUILD_BALANCED; mode++) {
+        BDDCreateOptions options = {.mode = mode};
+        clock_t start = clock();
+        BDD* bdd = BDD_create_from_file(file, order, &options);
+        clock_t end = clock();
+        update_node_count(bdd);
+        printf("Mode %s: %.2f ms, %d nodes (BDD_create: %d)\n", mode == BUILD_SEQUENTIAL ? "sequential" : "balanced",
+               (double)(end - start) * 1000 / CLOCKS_PER_SEC, bdd->node_count, reference->node_count);
+        test_all_combinations(bdd, dnf, BDD_input_width(bdd));
+
+        // Both constructors must number the inputs alike, not just agree
+        // on the function of the named variables
+        int width = BDD_input_width(bdd);
+        char* inputs = calloc(width + 1, 1);
+        uint64_t passed = 0, total = width <= 20 ? 1ULL << width : 0;
+        for (uint64_t i = 0; i < total; i++) {
+            for (int j = 0; j < width; j++) inputs[j] = i >> j & 1 ? '1' : '0';
+            passed += BDD_use(bdd, inputs) == BDD_use(reference, inputs);
         }
-        
-        char expected = evaluate_dnf(dnf, inputs);
-        char actual = BDD_use(bdd, inputs);
-        
-        if (expected != actual) {
-            printf("Test failed for inputs %s: expected %c, got %c\n", 
-                  inputs, expected, actual);
-        } else {
-            passed++;
+        if (width != BDD_input_width(reference)) passed = 0;
+        printf("Passed %llu/%llu tests (%.2f%%) against BDD_create input by input\n\n", (unsigned long long)passed,
+               (unsigned long long)total, total ? 100.0 * passed / total : 0.0);
+        free(inputs);
+        BDD_free(bdd);
+        rewind(file);
+    }
+
+    BDD_free(reference);
+    fclose(file);
+}
+
+// Loads a copy of a saved image with `length` bytes at `offset` replaced
+// and the checksum recomputed, so only the structural checks can reject it
+static bool load_patched(const char* image, long size, long offset, const void* bytes, size_t length) {
+    char* copy = malloc(size);
+    memcpy(copy, image, size);
+    memcpy(copy + offset, bytes, length);
+    uint64_t checksum = fnv64_update(FNV64_OFFSET, copy, size - sizeof(uint64_t));
+    memcpy(copy + size - sizeof(uint64_t), &checksum, sizeof(checksum));
+
+    FILE* file = tmpfile();
+    fwrite(copy, 1, size, file);
+    rewind(file);
+    BDD* bdd = BDD_load(file);
+    fclose(file);
+    free(copy);
+    BDD_free(bdd);
+    return bdd != NULL;
+}
+
+// Saves the BDD, evaluates the image through a read-only mapping and loads
+// it back into a full BDD
+void test_serialization(const char* dnf, const char* order) {
+    printf("Testing serialization for DNF: %s\n", dnf);
+
+    BDD* bdd = BDD_create(dnf, order);
+    update_node_count(bdd);
+    FILE* file = tmpfile();
+    if (!file || BDD_save(bdd, file) != 0) {
+        printf("Saving failed\n\n");
+        if (file) fclose(file);
+        BDD_free(bdd);
+        return;
+    }
+    long size = ftell(file);
+    printf("Saved %d nodes in %ld bytes\n", bdd->node_count, size);
+
+    void* image = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    BDDFrozen mapped;
+    if (image != MAP_FAILED && BDD_frozen_map(&mapped, image, size) == 0) {
+        int width = BDD_input_width(bdd);
+        char* inputs = malloc(width + 1);
+        inputs[width] = '\0';
+        int passed = 0;
+        for (int i = 0; i < 1 << width; i++) {
+            for (int j = 0; j < width; j++) inputs[j] = (i & (1 << (width - j - 1))) ? '1' : '0';
+            if (BDD_frozen_use(&mapped, inputs) == BDD_use(bdd, inputs)) passed++;
         }
+        printf("Mapped image matched BDD_use on %d/%d assignments\n", passed, 1 << width);
+        free(inputs);
+    } else {
+        printf("Mapping the saved image failed\n");
     }
-    
-    printf("Passed %d/%d tests (%.2f%%)\n\n", passed, total_tests, 
-          (float)passed/total_tests*100);
+    if (image != MAP_FAILED) munmap(image, size);
+
+    // Crafted files with a valid checksum: a name that is not a capital
+    // letter, a name given twice and a variable placed on two levels
+    rewind(file);
+    char* saved = malloc(size);
+    if (fread(saved, 1, size, file) == (size_t)size && bdd->var_count >= 2) {
+        long order_at = sizeof(BDDFileHeader), names_at = order_at + 4L * bdd->var_count;
+        int rejected = 0;
+        rejected += !load_patched(saved, size, names_at, "[", 1);
+        rejected += !load_patched(saved, size, names_at, saved + names_at + 2, 1);
+        rejected += !load_patched(saved, size, order_at + 4, saved + order_at, 4);
+        printf("Passed %d/3 tests (%.2f%%) on crafted files\n", rejected, 100.0 * rejected / 3);
+    }
+    free(saved);
+
+    rewind(file);
+    BDD* loaded = BDD_load(file);
+    fclose(file);
+    if (!loaded) {
+        printf("Loading failed\n\n");
+        BDD_free(bdd);
+        return;
+    }
+    char* loaded_order = BDD_order_string(loaded);
+    printf("Loaded %d nodes with order %s\n", loaded->node_count, loaded_order);
+    free(loaded_order);
+    test_all_combinations(loaded, dnf, BDD_input_width(loaded));
+
+    BDD_free(loaded);
+    BDD_free(bdd);
+}
+
+// Builds without automatic collection, then collects by hand to show how
+// much of the arena construction left dead
+void test_gc(const char* dnf, const char* order) {
+    printf("Testing garbage collection for DNF: %s\n", dnf);
+
+    BDDCreateOptions keep_dead = {.gc_dead_fraction = 1};
+    BDD* bdd = BDD_create_ex(dnf, order, &keep_dead);
+    int held = bdd->arena.in_use;
+    int dead = bdd->dead_nodes;
+    int freed = BDD_collect_garbage(bdd);
+    printf("Arena held %d nodes, %d of them dead; collection freed %d, %d remain\n",
+           held, dead, freed, (int)bdd->arena.in_use);
+
+    test_all_combinations(bdd, dnf, BDD_input_width(bdd));
+    BDD_free(bdd);
+}
+
+// Builds under node limits and a memory cap. Builds they stop must fail
+// with the right errno and give back every byte; a manager must keep the
+// functions it already had.
+void test_limits(const char* dnf, const char* order) {
+    printf("Testing node and memory limits for DNF: %s\n", dnf);
+
+    BDD* reference = BDD_create(dnf, order);
+    update_node_count(reference);
+    int nodes = reference->node_count;
+    size_t baseline = BDD_memory_in_use();
+    int passed = 0, total = 0;
+
+    for (BDDBuildMode mode = BUILD_SEQUENTIAL; mode <= BUILD_CLUSTERED; mode++) {
+        BDDCreateOptions tight = {.mode = mode, .node_limit = nodes / 2}, loose = {.mode = mode, .node_limit = 4 * nodes};
+        errno = 0;
+        BDD* stopped = BDD_create_ex(dnf, order, &tight);
+        passed += !stopped && errno == EFBIG;
+        BDD* fits = BDD_create_ex(dnf, order, &loose);
+        if (fits) update_node_count(fits);
+        passed += fits && fits->node_count == nodes;
+        BDD_free(fits);
+        passed += BDD_memory_in_use() == baseline;
+        total += 3;
+    }
+    printf("Limit %d stops every mode, limit %d lets them finish with %d nodes\n", nodes / 2, 4 * nodes, nodes);
+
+    // The first two terms already cover the third, whose 13-node cube
+    // chain is dead at once, so a limit above the one live node must let
+    // the build finish
+    BDDCreateOptions chain = {.mode = BUILD_SEQUENTIAL, .node_limit = 4};
+    BDD* subsumed = BDD_create_ex("AB+A!B+ACDEFGHIJKLMN", "ABCDEFGHIJKLMN", &chain);
+    passed += subsumed != NULL;
+    total++;
+    BDD_free(subsumed);
+
+    size_t previous = BDD_set_memory_limit(BDD_memory_in_use());
+    errno = 0;
+    BDD* capped = BDD_create(dnf, order);
+    BDD_set_memory_limit(previous);
+    passed += !capped && errno == ENOMEM && BDD_memory_in_use() == baseline;
+    total++;
+    printf("Memory cap of %zu bytes: %s\n", baseline, capped ? "build finished" : strerror(errno));
+    BDD_free(capped);
+
+    // A stopped add leaves the manager's other functions as they were
+    BDDCreateOptions budget = {.node_limit = nodes / 2};
+    BDDManager* mgr = BDD_manager_create(order, &budget);
+    BDDFunction small = BDD_manager_add(mgr, "AB+!AC");
+    BDD* expected = BDD_create("AB+!AC", order);
+    BDDFunction large = BDD_manager_add(mgr, dnf);
+    passed += large == BDD_NONE && errno == EFBIG && BDD_manager_nodes(mgr, &small, 1) == bdd_live_nodes(mgr) + 1;
+    total++;
+    int width = BDD_input_width(reference);
+    char* inputs = malloc(width + 1);
+    inputs[width] = '\0';
+    for (int k = 0; k < 1 << width; k++) {
+        for (int j = 0; j < width; j++) inputs[j] = (k & (1 << (width - j - 1))) ? '1' : '0';
+        passed += BDD_manager_use(mgr, small, inputs) == BDD_use(expected, inputs);
+        total++;
+    }
+    printf("Passed %d/%d tests (%.2f%%)\n\n", passed, total, 100.0 * passed / total);
+
     free(inputs);
+    BDD_free(expected);
+    BDD_free(mgr);
+    BDD_free(reference);
 }
 
-// Function to test BDD creation and measure reduction
-void test_bdd_creation(const char* dnf, const char* order) {
-    printf("Testing BDD creation for DNF: %s\n", dnf);
-    printf("Using order: %s\n", order);
-    
+// Checks BDD_use_batch against BDD_use on every assignment and compares
+// their throughput
+void test_batch_eval(const char* dnf, const char* order) {
+    printf("Testing batch evaluation for DNF: %s\n", dnf);
+
+    BDD* bdd = BDD_create(dnf, order);
+    int width = BDD_input_width(bdd);
+    size_t count = (size_t)1 << width;
+    size_t words = BDD_batch_words(count);
+
+    // Bit-sliced inputs in the same enumeration order as test_all_combinations
+    uint64_t *inputs = calloc((size_t)width * words, sizeof(uint64_t));
+    for (size_t k = 0; k < count; k++) {
+        for (int j = 0; j < width; j++) {
+            if (k & ((size_t)1 << (width - j - 1))) inputs[j * words + k / 64] |= 1ULL << (k % 64);
+        }
+    }
+    uint64_t *results = malloc(words * sizeof(uint64_t));
+
     clock_t start = clock();
+    BDD_use_batch(bdd, inputs, count, results);
+    clock_t end = clock();
+    double batch_ms = (double)(end - start) * 1000 / CLOCKS_PER_SEC;
+
+    char* assignment = malloc(width + 1);
+    assignment[width] = '\0';
+    size_t passed = 0;
+    start = clock();
+    for (size_t k = 0; k < count; k++) {
+        for (int j = 0; j < width; j++) assignment[j] = (k & ((size_t)1 << (width - j - 1))) ? '1' : '0';
+        char expected = BDD_use(bdd, assignment);
+        char actual = (results[k / 64] >> (k % 64)) & 1 ? '1' : '0';
+        if (expected == actual) passed++;
+    }
+    end = clock();
+    double single_ms = (double)(end - start) * 1000 / CLOCKS_PER_SEC;
+
+    printf("Batch matched BDD_use on %zu/%zu assignments\n", passed, count);
+    printf("Batch: %.2f ms, one at a time: %.2f ms\n\n", batch_ms, single_ms);
+
+    free(assignment);
+    free(results);
+    free(inputs);
+    BDD_free(bdd);
+}
+
+// Builds a generated workload with and without apply workers and compares
+// the two on random inputs. The merges of the threaded build run in
+// parallel and must still reach a BDD of the same size.
+void test_parallel_apply(int vars, int terms, int threads) {
+    WorkloadSpec spec = {.family = WORKLOAD_RANDOM, .vars = vars, .terms = terms, .density = 0.75, .window = 12, .seed = 3};
+    char* dnf = workload_generate(&spec, NULL);
+    char* order = workload_order(&spec);
+    printf("Testing parallel apply with %d threads on %d random terms over %d variables\n", threads, terms, vars);
+
+    for (BDDBuildMode mode = BUILD_BALANCED; mode <= BUILD_CLUSTERED; mode++) {
+        BDDCreateOptions single = {.mode = mode}, parallel = {.mode = mode, .threads = threads, .parallel_apply = true};
+        uint64_t start = bdd_now_ns();
+        BDD* reference = BDD_create_ex(dnf, order, &single);
+        uint64_t middle = bdd_now_ns();
+        BDD* bdd = BDD_create_ex(dnf, order, &parallel);
+        uint64_t end = bdd_now_ns();
+        update_node_count(reference);
+        update_node_count(bdd);
+        printf("Mode %s: %d nodes in %.2f ms, with threads %d nodes in %.2f ms\n",
+               mode == BUILD_BALANCED ? "balanced" : "clustered", reference->node_count,
+               (middle - start) / 1e6, bdd->node_count, (end - middle) / 1e6);
+
+        int width = BDD_input_width(bdd);
+        char* inputs = malloc(width + 1);
+        inputs[width] = '\0';
+        unsigned int seed = 5;
+        int passed = 0, total = 100000;
+        for (int i = 0; i < total; i++) {
+            for (int j = 0; j < width; j++) inputs[j] = rand_r(&seed) & 1 ? '1' : '0';
+            passed += BDD_use(bdd, inputs) == BDD_use(reference, inputs);
+        }
+        if (bdd->node_count != reference->node_count) passed = 0;
+        printf("Passed %d/%d tests (%.2f%%)\n\n", passed, total, 100.0 * passed / total);
+
+        free(inputs);
+        BDD_free(bdd);
+        BDD_free(reference);
+    }
+    free(order);
+    free(dnf);
+}
+
+// Searches orders for a generated workload with one worker and with
+// several in every construction mode. Candidates and their budgets must
+// not depend on scheduling, so both runs pick the same order and size.
+void test_order_search(int vars, int terms, int threads) {
+    WorkloadSpec spec = {.family = WORKLOAD_RANDOM, .vars = vars, .terms = terms, .density = 0.5, .window = 10, .seed = 1};
+    char* dnf = workload_generate(&spec, NULL);
+    printf("Testing order search with 1 and %d threads on %d random terms over %d variables\n", threads, terms, vars);
+
+    static const char* const mode_names[] = {"sequential", "balanced", "clustered"};
+    int passed = 0, total = 0;
+    for (BDDBuildMode mode = BUILD_SEQUENTIAL; mode <= BUILD_CLUSTERED; mode++) {
+        BDDOrderSearchOptions single = {.threads = 1, .seed = 11, .create = {.mode = mode}};
+        BDDOrderSearchOptions parallel = single;
+        parallel.threads = threads;
+        BDD* one = BDD_create_with_best_order_ex(dnf, &single);
+        BDD* many = BDD_create_with_best_order_ex(dnf, &parallel);
+        char* one_order = BDD_order_string(one);
+        char* many_order = BDD_order_string(many);
+        printf("Mode %s: %d nodes with 1 thread, %d nodes with %d\n", mode_names[mode], one->node_count,
+               many->node_count, threads);
+        passed += one->node_count == many->node_count && strcmp(one_order, many_order) == 0;
+        total++;
+        free(many_order);
+        free(one_order);
+        BDD_free(many);
+        BDD_free(one);
+    }
+    printf("Passed %d/%d tests (%.2f%%)\n\n", passed, total, 100.0 * passed / total);
+    free(dnf);
+}
+
+// Checks BDD_frozen_use against BDD_use on every assignment, compares their
+// speed and prints the generated C code for small BDDs
+void test_frozen(const char* dnf, const char* order) {
+    printf("Testing frozen evaluation for DNF: %s\n", dnf);
+
     BDD* bdd = BDD_create(dnf, order);
+    BDDFrozen* frozen = BDD_freeze(bdd);
+    int width = BDD_input_width(bdd);
+    int total = 1 << width;
+    printf("Frozen form: %d nodes in %zu bytes\n", frozen->count, frozen->count * sizeof(FrozenNode));
+
+    char* inputs = malloc(width + 1);
+    inputs[width] = '\0';
+    char* expected = malloc(total);
+
+    clock_t start = clock();
+    for (int i = 0; i < total; i++) {
+        for (int j = 0; j < width; j++) inputs[j] = (i & (1 << (width - j - 1))) ? '1' : '0';
+        expected[i] = BDD_use(bdd, inputs);
+    }
     clock_t end = clock();
-    
-    printf("Creation time: %.2f ms\n", (double)(end - start) * 1000 / CLOCKS_PER_SEC);
-    printf("Node count: %d\n", bdd->node_count);
-    
-    int var_count = strlen(order);
-    test_all_combinations(bdd, dnf, var_count);
-    
-    // Cleanup
-    for (int i = 0; i < bdd->unique.size; i++) 
-        free(bdd->unique.nodes[i]);
-    free(bdd->unique.nodes);
-    free(bdd->var_order);
-    free(bdd);
+    double bdd_ms = (double)(end - start) * 1000 / CLOCKS_PER_SEC;
+
+    int passed = 0;
+    start = clock();
+    for (int i = 0; i < total; i++) {
+        for (int j = 0; j < width; j++) inputs[j] = (i & (1 << (width - j - 1))) ? '1' : '0';
+        if (BDD_frozen_use(frozen, inputs) == expected[i]) passed++;
+    }
+    end = clock();
+    double frozen_ms = (double)(end - start) * 1000 / CLOCKS_PER_SEC;
+
+    printf("Frozen matched BDD_use on %d/%d assignments\n", passed, total);
+    printf("BDD_use: %.2f ms, frozen: %.2f ms\n", bdd_ms, frozen_ms);
+
+    if (frozen->count <= 8) BDD_frozen_emit_c(frozen, stdout, "bdd_eval");
+    printf("\n");
+
+    free(expected);
+    free(inputs);
+    BDD_frozen_free(frozen);
+    BDD_free(bdd);
 }
 
 void test_optimized_bdd(const char* dnf) {
@@ -674,31 +5486,33 @@ void test_optimized_bdd(const char* dnf) {
     clock_t end = clock();
     
     printf("Optimization time: %.2f ms\n", (double)(end - start) * 1000 / CLOCKS_PER_SEC);
-    printf("Optimal order: %s\n", bdd->var_order);
+    char *order = BDD_order_string(bdd);
+    printf("Optimal order: %s\n", order);
     printf("Node count: %d\n", bdd->node_count);
+    free(order);
     
-    int var_count = strlen(bdd->var_order);
-    test_all_combinations(bdd, dnf, var_count);
+    test_all_combinations(bdd, dnf, BDD_input_width(bdd));
     
     // Cleanup
-    for (int i = 0; i < bdd->unique.size; i++) 
-        free(bdd->unique.nodes[i]);
-    free(bdd->unique.nodes);
-    free(bdd->var_order);
-    free(bdd);
+    BDD_free(bdd);
 }
 
 
 // -------------------- Main --------------------
-int main() {
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) return run_benchmarks(argc - 2, argv + 2);
+
     srand(time(NULL));
 
     BDD *bdd = BDD_create_with_best_order("A!B!C+!AB!C+!A!BC");
+    BDD_free(bdd);
     
     // Simple test cases
     test_bdd_creation("AB+!AC", "ABC");
     test_bdd_creation("A+B+C", "ABC");
     test_bdd_creation("A!B+!AB", "AB");
+    test_syntax("admin + guest", "admin guest");
+    test_long_term(2000);
     
     // Test optimized creation
     test_optimized_bdd("AB+!AC");
@@ -708,6 +5522,25 @@ int main() {
     // Test with large DNFs
     test_bdd_creation("AMBLFG+JDBNHC+!AJ!EC+FIHMNE+KDH!LM+AK!BNG+E!HKAI+GJLNBE+!LDKEG+HGNKFD+FDCGJA+BJM!EA+!NIHMB+EJ!FAG+LGMBCD+BEGFIK+HMLDCG+B!NDHCM", "ABCDEFGHIJKLMN");
     test_optimized_bdd("AMBLFG+JDBNHC+!AJ!EC+FIHMNE+KDH!LM+AK!BNG+E!HKAI+GJLNBE+!LDKEG+HGNKFD+FDCGJA+BJM!EA+!NIHMB+EJ!FAG+LGMBCD+BEGFIK+HMLDCG+B!NDHCM");
+    test_reorder("AMBLFG+JDBNHC+!AJ!EC+FIHMNE+KDH!LM+AK!BNG+E!HKAI+GJLNBE+!LDKEG+HGNKFD+FDCGJA+BJM!EA+!NIHMB+EJ!FAG+LGMBCD+BEGFIK+HMLDCG+B!NDHCM", "ABCDEFGHIJKLMN");
+    test_model_counting("AMBLFG+JDBNHC+!AJ!EC+FIHMNE+KDH!LM+AK!BNG+E!HKAI+GJLNBE+!LDKEG+HGNKFD+FDCGJA+BJM!EA+!NIHMB+EJ!FAG+LGMBCD+BEGFIK+HMLDCG+B!NDHCM", "ABCDEFGHIJKLMN");
+    test_model_counting("AB+!AC+E", "ABCE");
+    test_restrict("AMBLFG+JDBNHC+!AJ!EC+FIHMNE+KDH!LM+AK!BNG+E!HKAI+GJLNBE+!LDKEG+HGNKFD+FDCGJA+BJM!EA+!NIHMB+EJ!FAG+LGMBCD+BEGFIK+HMLDCG+B!NDHCM", "ABCDEFGHIJKLMN", "1-0---1-------", "DH");
+    test_manager("AMBLFG+JDBNHC+!AJ!EC+FIHMNE+KDH!LM+AK!BNG+E!HKAI+GJLNBE+!LDKEG+HGNKFD+FDCGJA+BJM!EA+!NIHMB+EJ!FAG+LGMBCD+BEGFIK+HMLDCG+B!NDHCM", "ABCDEFGHIJKLMN");
+    test_stats("AMBLFG+JDBNHC+!AJ!EC+FIHMNE+KDH!LM+AK!BNG+E!HKAI+GJLNBE+!LDKEG+HGNKFD+FDCGJA+BJM!EA+!NIHMB+EJ!FAG+LGMBCD+BEGFIK+HMLDCG+B!NDHCM", "ABCDEFGHIJKLMN");
+    test_term_pruning("AB+ABC+BA+!CD+!CDA+A!A+DE!C+!C!CD+E", "ABCDE");
+    test_streaming("AMBLFG+JDBNHC+!AJ!EC+FIHMNE+KDH!LM+AK!BNG+E!HKAI+GJLNBE+!LDKEG+HGNKFD+FDCGJA+BJM!EA+!NIHMB+EJ!FAG+LGMBCD+BEGFIK+HMLDCG+B!NDHCM", "ABCDEFGHIJKLMN");
+    test_streaming("tenant_eu & !beta + admin + beta & region_7 & !tenant_eu", "admin");
+    test_streaming("y_1 & !x_1 + z_1", "x_1 y_1 z_1");
+    test_serialization("AMBLFG+JDBNHC+!AJ!EC+FIHMNE+KDH!LM+AK!BNG+E!HKAI+GJLNBE+!LDKEG+HGNKFD+FDCGJA+BJM!EA+!NIHMB+EJ!FAG+LGMBCD+BEGFIK+HMLDCG+B!NDHCM", "NMLKJIHGFEDCBA");
+    test_gc("AMBLFG+JDBNHC+!AJ!EC+FIHMNE+KDH!LM+AK!BNG+E!HKAI+GJLNBE+!LDKEG+HGNKFD+FDCGJA+BJM!EA+!NIHMB+EJ!FAG+LGMBCD+BEGFIK+HMLDCG+B!NDHCM", "ABCDEFGHIJKLMN");
+    test_limits("AMBLFG+JDBNHC+!AJ!EC+FIHMNE+KDH!LM+AK!BNG+E!HKAI+GJLNBE+!LDKEG+HGNKFD+FDCGJA+BJM!EA+!NIHMB+EJ!FAG+LGMBCD+BEGFIK+HMLDCG+B!NDHCM", "ABCDEFGHIJKLMN");
+    test_batch_eval("AMBLFG+JDBNHC+!AJ!EC+FIHMNE+KDH!LM+AK!BNG+E!HKAI+GJLNBE+!LDKEG+HGNKFD+FDCGJA+BJM!EA+!NIHMB+EJ!FAG+LGMBCD+BEGFIK+HMLDCG+B!NDHCM", "ABCDEFGHIJKLMN");
+    test_parallel_apply(40, 400, 4);
+    test_order_search(18, 140, 4);
+    test_frozen("AB+!AC", "ABC");
+    test_frozen("AMBLFG+JDBNHC+!AJ!EC+FIHMNE+KDH!LM+AK!BNG+E!HKAI+GJLNBE+!LDKEG+HGNKFD+FDCGJA+BJM!EA+!NIHMB+EJ!FAG+LGMBCD+BEGFIK+HMLDCG+B!NDHCM", "ABCDEFGHIJKLMN");
+    test_build_modes("AMBLFG+JDBNHC+!AJ!EC+FIHMNE+KDH!LM+AK!BNG+E!HKAI+GJLNBE+!LDKEG+HGNKFD+FDCGJA+BJM!EA+!NIHMB+EJ!FAG+LGMBCD+BEGFIK+HMLDCG+B!NDHCM", "ABCDEFGHIJKLMN");
     
     // Generate and test random DNFs
     for (int i = 0; i < 10; i++) {